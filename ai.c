@@ -0,0 +1,182 @@
+/*
+ * ai.c
+ *
+ * Built-in opponent for single-player games. The move comes from a
+ * negamax alpha-beta search over the bitboard, bounded by AI_NODE_BUDGET
+ * visited positions. The first move comes from an opening rule (centre,
+ * else the next cell in search order). On 3x3 that is perfect play and
+ * leaves at most seven empty cells; a full-depth search of those needs
+ * under 900 positions, so every later reply is solved exactly inside the
+ * budget. Positions with more empty cells, as on the larger boards, are
+ * deepened one ply at a time instead, and an interrupted depth is thrown
+ * away in favour of the last finished one. No search goes deeper than
+ * AI_MAX_DEPTH plies, as each one is a stack frame; on 3x3 and 4x4 the
+ * empty cells or the budget run out first, on 5x5 the cap keeps the stack
+ * inside the RAM.
+ * Easier levels replace a share of the moves with a random empty cell.
+ */
+
+#include "ai.h"
+#include "game.h"
+
+#define SCORE_WIN   (GAME_CELLS + 1)                                    // plus the empty cells left, so faster wins score higher
+#define FULL_DEPTH  7                                                   // empty cells that are searched to the end straight away
+
+static unsigned char moveOrder[GAME_CELLS];                             // centre out, corners of each ring first
+static const unsigned char randomPercent[AI_LEVELS] = {50, 20, 0};
+
+static unsigned int seed = 0xACE1;
+static unsigned int nodesLeft;
+static unsigned char aborted;
+
+// 16-bit xorshift
+static unsigned int nextRandom(void) {
+    seed ^= seed << 7;
+    seed ^= seed >> 9;
+    seed ^= seed << 8;
+    return seed;
+}
+
+static unsigned char countCells(GameMask mask) {
+    unsigned char count = 0;
+
+    while (mask) {
+        mask &= mask - 1;                                               // clear the lowest set bit
+        count++;
+    }
+    return count;
+}
+
+// Rank of a cell in the search order, lower is tried first
+static unsigned char cellRank(unsigned char cell) {
+    signed char row = 2 * (cell / GAME_SIZE) - (GAME_SIZE - 1);         // doubled distances from the centre
+    signed char column = 2 * (cell % GAME_SIZE) - (GAME_SIZE - 1);
+    unsigned char rowDistance = (row < 0) ? -row : row;
+    unsigned char columnDistance = (column < 0) ? -column : column;
+    unsigned char ring = (rowDistance > columnDistance) ? rowDistance : columnDistance;
+
+    return ring * 2 * GAME_SIZE - (rowDistance + columnDistance);       // corners of a ring are furthest on both axes
+}
+
+// Insertion sort of the cells by rank, once
+static void buildMoveOrder(void) {
+    unsigned char cell, i;
+
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        for (i = cell; i > 0 && cellRank(moveOrder[i - 1]) > cellRank(cell); i--) {
+            moveOrder[i] = moveOrder[i - 1];
+        }
+        moveOrder[i] = cell;
+    }
+}
+
+// Score for the side to move ('me'), looking depth plies ahead
+static int search(GameMask me, GameMask them, unsigned char depth, int alpha, int beta) {
+    GameMask empty = ~(me | them) & GAME_ALL_CELLS;
+    unsigned char i;
+
+    if (!empty || depth == 0) {
+        return 0;                                                       // draw, or nothing known yet
+    }
+    if (nodesLeft == 0) {
+        aborted = 1;
+        return 0;
+    }
+    nodesLeft--;
+
+    for (i = 0; i < GAME_CELLS; i++) {
+        unsigned char cell = moveOrder[i];
+        GameMask bit = GAME_BIT(cell);
+        int score;
+
+        if (!(empty & bit)) {
+            continue;
+        }
+        if (game_completesLine(me | bit, bit)) {
+            return SCORE_WIN + countCells(empty);                       // nothing beats winning now
+        }
+
+        score = -search(them, me | bit, depth - 1, -beta, -alpha);
+        if (aborted) {
+            return 0;
+        }
+        if (score > alpha) {
+            alpha = score;
+            if (alpha >= beta) {
+                break;
+            }
+        }
+    }
+    return alpha;
+}
+
+void ai_seed(unsigned int value) {
+    seed ^= value;
+    if (!seed) {
+        seed = 0xACE1;                                                  // xorshift must not start at zero
+    }
+} // end ai_seed
+
+// Pick a cell for the given marker; the board must have an empty cell
+unsigned char ai_chooseMove(char marker, unsigned char level) {
+    GameMask me = (marker == 'X') ? board.x : board.o;
+    GameMask them = (marker == 'X') ? board.o : board.x;
+    GameMask empty = game_emptyCells();
+    unsigned char emptyCount = countCells(empty);
+    unsigned char best = game_nextEmpty(GAME_CELLS - 1);               // any legal move as a fallback
+    unsigned char lastDepth = (emptyCount < AI_MAX_DEPTH) ? emptyCount : AI_MAX_DEPTH;
+    unsigned char depth, i;
+
+    nodesLeft = AI_NODE_BUDGET;
+    if (moveOrder[0] == moveOrder[1]) {
+        buildMoveOrder();                                               // still all zero on the first call
+    }
+
+    if (level < AI_LEVELS && (nextRandom() % 100) < randomPercent[level]) {
+        unsigned char skip = nextRandom() % emptyCount;
+        for (i = 0; i < GAME_CELLS; i++) {
+            if ((empty & GAME_BIT(i)) && skip-- == 0) {
+                return i;
+            }
+        }
+    }
+
+    if (emptyCount >= GAME_CELLS - 1) {                                 // opening rule
+        return (empty & GAME_BIT(moveOrder[0])) ? moveOrder[0] : moveOrder[1];
+    }
+
+    for (depth = (emptyCount <= FULL_DEPTH) ? lastDepth : 1; depth <= lastDepth; depth++) {
+        int alpha = -SCORE_WIN - GAME_CELLS;
+        unsigned char bestAtDepth = best;
+
+        aborted = 0;
+        for (i = 0; i < GAME_CELLS; i++) {
+            unsigned char cell = moveOrder[i];
+            GameMask bit = GAME_BIT(cell);
+            int score;
+
+            if (!(empty & bit)) {
+                continue;
+            }
+            if (game_completesLine(me | bit, bit)) {
+                return cell;
+            }
+
+            score = -search(them, me | bit, depth - 1, -SCORE_WIN - GAME_CELLS, -alpha);
+            if (aborted) {
+                break;
+            }
+            if (score > alpha) {
+                alpha = score;
+                bestAtDepth = cell;
+            }
+        }
+
+        if (aborted) {
+            break;                                                      // keep the last finished depth
+        }
+        best = bestAtDepth;
+    }
+
+    return best;
+} // end ai_chooseMove
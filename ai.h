@@ -0,0 +1,31 @@
+/*
+ * ai.h
+ */
+
+#ifndef AI_H_
+#define AI_H_
+
+/* ====================================================================
+ * Single-Player Opponent Settings
+ * ==================================================================== */
+#define AI_EASY             0
+#define AI_MEDIUM           1
+#define AI_HARD             2
+#define AI_LEVELS           3
+
+// A position costs about 900 cycles on the G2553, estimated from the loop over the cells and the win checks
+// behind it (11 countRun calls per position on the deepest 3x3 reply), so a reply takes at most about
+// AI_NODE_BUDGET * 900 = 0.8 M cycles, 0.1 s at the 8 MHz CLOCK_BOOST
+#define AI_NODE_BUDGET      900                                         // positions searched per reply
+
+#ifndef AI_MAX_DEPTH
+#define AI_MAX_DEPTH        (GAME_CELLS > 16 ? 4 : 8)                   // plies searched at most, a stack frame each (ram.h)
+#endif
+
+/* ====================================================================
+ * AI Prototype Definitions
+ * ==================================================================== */
+void ai_seed(unsigned int);
+unsigned char ai_chooseMove(char, unsigned char);
+
+#endif /* AI_H_ */
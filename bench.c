@@ -0,0 +1,282 @@
+/*
+ * bench.c
+ *
+ * Micro-benchmarks for the display and rules paths, built in place of
+ * the game loop with -DBENCH_BUILD. Each routine runs BENCH_RUNS times
+ * from the same untimed starting state. A run is timed from the call
+ * until the I2C queue has drained, so display traffic the routine only
+ * queued is charged to it; the cost of taking the time is measured once
+ * and subtracted. Results go out on the UART at 9600 baud as CSV:
+ *
+ *   bench,routine,runs,min,mean,max,i2c_bytes
+ *   bench,drawGrid,16,...
+ *   bench,end
+ *
+ * min, mean and max are SMCLK cycles counted by Timer0_A, microseconds at
+ * every clock level but 16 MHz (-DBENCH_CLOCK picks the level); i2c_bytes
+ * is per run, address bytes included. The host build prints the same
+ * lines on stdout, timed on the simulated clock: bus waits only, the C
+ * code itself takes no time there, but a change in bus traffic or waiting
+ * shows up.
+ *
+ *   ./tictactoe-bench > bench.csv        (host build, see README.md)
+ */
+
+#ifdef BENCH_BUILD
+
+#include "hal.h"
+#include "clock.h"
+#include "i2c.h"
+#include "uart.h"
+#include "tone.h"
+#include "power.h"
+#include "ssd1306.h"
+#include "game.h"
+#include "ai.h"
+#include "timer.h"
+
+#ifdef HOST_BUILD
+#include <stdio.h>
+#include "host/gram.h"
+#endif
+
+#ifndef BENCH_RUNS
+#define BENCH_RUNS          16                                          // timed runs per routine
+#endif
+
+#ifndef BENCH_CLOCK
+#define BENCH_CLOCK         CLOCK_IDLE                                  // clock level the routines run at
+#endif
+
+typedef struct {
+    const char *name;
+    void (*setup)(void);                                                // untimed, restores the starting state, may be 0
+    void (*run)(void);
+} Benchmark;
+
+/* Supplied by main.c */
+extern unsigned int markerX;
+extern unsigned int markerY;
+extern char currentPlayer;
+extern unsigned int gameOver;
+extern unsigned char singlePlayer;
+void drawGrid(void);
+void drawCell(unsigned int, unsigned int);
+void moveMarker(void);
+unsigned char checkWinCondition(unsigned char);
+void flashStep(void);
+
+static char promptText[] = "Do you want to play?";
+static unsigned long overhead = 0;                                      // cycles a timed empty run takes
+
+// Mid-game position, cursor in the top left corner and nothing drawn yet
+static void setupBoard(void) {
+    timer_stop(flashStep);                                              // a result animation left armed by the last run
+    game_reset();
+    game_set(0, 'X');
+    game_set(4, 'O');
+    game_set(8, 'X');
+    game_set(2, 'O');
+    markerX = 0;
+    markerY = 0;
+    currentPlayer = 'X';
+    gameOver = 0;
+    singlePlayer = 1;                                                   // keep the link out of it
+} // end setupBoard
+
+// The opponent's first searched reply as 'X': it opened in the centre by the opening rule and the player
+// took the far corner, leaving seven empty cells searched to the end, 883 positions, the most of any answer
+static void setupReply(void) {
+    game_reset();
+    game_set(4, 'X');
+    game_set(8, 'O');
+} // end setupReply
+
+// The same position on screen, so only what changes is redrawn
+static void setupScreen(void) {
+    setupBoard();
+    drawGrid();
+    stopBuzzer();
+} // end setupScreen
+
+// The screen with 'O' just placed to finish the diagonal 2-4-6, the losing side for 'X'
+static void setupWin(void) {
+    setupScreen();
+    game_set(6, 'O');
+} // end setupWin
+
+static void runNothing(void) {
+} // end runNothing
+
+static void runClearDisplay(void) {
+    ssd1306_clearDisplay();
+} // end runClearDisplay
+
+static void runPrintText(void) {
+    ssd1306_printText(0, 0, promptText);
+} // end runPrintText
+
+static void runDrawGrid(void) {
+    drawGrid();
+} // end runDrawGrid
+
+static void runDrawCell(void) {
+    drawCell(1, 1);
+} // end runDrawCell
+
+static void runMoveMarker(void) {
+    moveMarker();
+} // end runMoveMarker
+
+static void runCheckWin(void) {
+    checkWinCondition(2);
+} // end runCheckWin
+
+static void runCheckWinLine(void) {
+    checkWinCondition(6);
+} // end runCheckWinLine
+
+static void runChooseMove(void) {
+    ai_chooseMove('X', AI_HARD);
+} // end runChooseMove
+
+static const Benchmark benchmarks[] = {
+    {"ssd1306_clearDisplay", 0, runClearDisplay},
+    {"ssd1306_printText", 0, runPrintText},
+    {"drawGrid", setupBoard, runDrawGrid},
+    {"drawCell", setupScreen, runDrawCell},                             // what drawMarker became
+    {"moveMarker", setupScreen, runMoveMarker},
+    {"checkWinCondition", setupBoard, runCheckWin},                     // no line, the game goes on
+    {"ai_chooseMove", setupReply, runChooseMove},                       // cycles per reply, at most AI_NODE_BUDGET positions
+    {"checkWinCondition_win", setupWin, runCheckWinLine},               // finds the line, draws it and starts the result
+};
+
+static void emit(const char *text) {
+#ifdef HOST_BUILD
+    fputs(text, stdout);
+#else
+    const char *end = text;
+
+    while (*end) {
+        end++;
+    }
+    uart_write((const unsigned char *)text, end - text);
+#endif
+} // end emit
+
+static char *appendText(char *text, const char *from) {
+    while (*from) {
+        *text++ = *from++;
+    }
+    return text;
+} // end appendText
+
+// Append ",<value>" to text, returns the new end
+static char *appendNumber(char *text, unsigned long value) {
+    char digits[10];
+    unsigned char count = 0;
+
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    *text++ = ',';
+    while (count) {
+        *text++ = digits[--count];
+    }
+    return text;
+} // end appendNumber
+
+// Cycles one run takes, from the call until the I2C bus is idle again; adds the bytes it sent to *bytes
+static unsigned long timeRun(const Benchmark *benchmark, unsigned long *bytes) {
+    unsigned long start, cycles, sent;
+
+    if (benchmark->setup) {
+        benchmark->setup();
+    }
+    i2c_flush();
+
+    sent = i2cStats.bytes;
+    start = hal_cycleCount();
+    benchmark->run();
+    i2c_flush();
+    cycles = hal_cycleCount() - start;
+    *bytes += i2cStats.bytes - sent;
+
+    return (cycles > overhead) ? cycles - overhead : 0;
+} // end timeRun
+
+static void measure(const Benchmark *benchmark) {
+    char line[64];
+    char *end;
+    unsigned long least = ~0UL, most = 0, total = 0, bytes = 0;
+    unsigned int i;
+
+    for (i = 0; i < BENCH_RUNS; i++) {
+        unsigned long cycles = timeRun(benchmark, &bytes);
+
+        total += cycles;
+        if (cycles < least) {
+            least = cycles;
+        }
+        if (cycles > most) {
+            most = cycles;
+        }
+    }
+
+    end = appendText(line, "bench,");
+    end = appendText(end, benchmark->name);
+    end = appendNumber(end, BENCH_RUNS);
+    end = appendNumber(end, least);
+    end = appendNumber(end, (total + BENCH_RUNS / 2) / BENCH_RUNS);
+    end = appendNumber(end, most);
+    end = appendNumber(end, (bytes + BENCH_RUNS / 2) / BENCH_RUNS);
+    *end++ = '\n';
+    *end = '\0';
+    emit(line);
+} // end measure
+
+int main(void) {
+    static const Benchmark empty = {"", 0, runNothing};
+    unsigned long bytes = 0, least = ~0UL;
+    unsigned int i;
+
+    hal_initClocks();
+    initI2C();
+    initBuzzer();
+    initUART();
+#ifdef HOST_BUILD
+    gram_reset();
+#endif
+    ssd1306_init();
+    hal_enableInterrupts();
+    clock_set(BENCH_CLOCK);
+    hal_startCycleCount();
+
+    for (i = 0; i < BENCH_RUNS; i++) {
+        unsigned long cycles = timeRun(&empty, &bytes);                 // overhead is still 0, so this is the raw time
+        if (cycles < least) {
+            least = cycles;
+        }
+    }
+    overhead = least;
+
+    emit("bench,routine,runs,min,mean,max,i2c_bytes\n");
+    for (i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        measure(&benchmarks[i]);
+    }
+    emit("bench,end\n");
+
+#ifdef HOST_BUILD
+    return 0;
+#else
+    uart_flush();
+    while (1) {
+        hal_disableInterrupts();
+        enterLowPower(0);                                               // done, nothing left to wake up for
+    }
+#endif
+} // end main
+
+#endif /* BENCH_BUILD */
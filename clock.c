@@ -0,0 +1,78 @@
+/*
+ * clock.c
+ *
+ * DCO level switching from the factory calibration in info flash. While
+ * SMCLK stays the same (1 and 8 MHz) a switch is a few register writes.
+ * When it changes, the I2C queue and the UART transmitter are drained
+ * first and every SMCLK driver then re-applies its value for the new
+ * level; a byte being received meanwhile is lost to a framing error and
+ * the link retransmits it.
+ */
+
+#include "clock.h"
+#include "i2c.h"
+#include "uart.h"
+#include "tone.h"
+#include <msp430.h>
+
+static unsigned char level = CLOCK_IDLE;
+
+// Load the calibration for a level; DCOCTL goes to zero first so no intermediate setting overshoots
+static void setDCO(unsigned char to) {
+    DCOCTL = 0;
+    if (to == CLOCK_16MHZ) {
+        BCSCTL1 = CALBC1_16MHZ;
+        DCOCTL = CALDCO_16MHZ;
+    } else if (to == CLOCK_8MHZ) {
+        BCSCTL1 = CALBC1_8MHZ;
+        DCOCTL = CALDCO_8MHZ;
+    } else {
+        BCSCTL1 = CALBC1_1MHZ;
+        DCOCTL = CALDCO_1MHZ;
+    }
+} // end setDCO
+
+// Start at CLOCK_IDLE; the drivers are set up afterwards and read the level themselves
+void clock_init(void) {
+    BCSCTL2 = CLOCK_SMCLK_SHIFT(CLOCK_IDLE) << 1;                       // MCLK = DCO, SMCLK = DCO >> DIVSx
+    setDCO(CLOCK_IDLE);
+    level = CLOCK_IDLE;
+} // end clock_init
+
+void clock_set(unsigned char to) {
+    unsigned char reapply;
+    unsigned int state;
+
+    if (to == level) {
+        return;
+    }
+
+    reapply = CLOCK_SMCLK_HZ(to) != CLOCK_SMCLK_HZ(level);
+    if (reapply) {
+        i2c_flush();                                                    // no byte may straddle a divider change
+        uart_flush();
+    }
+
+    // Change the divider and the DCO so that SMCLK passes through the slower of the two settings, never a faster one
+    state = __get_interrupt_state();
+    __disable_interrupt();
+    if (to > level) {
+        BCSCTL2 = CLOCK_SMCLK_SHIFT(to) << 1;
+        setDCO(to);
+    } else {
+        setDCO(to);
+        BCSCTL2 = CLOCK_SMCLK_SHIFT(to) << 1;
+    }
+    level = to;
+    __set_interrupt_state(state);
+
+    if (reapply) {
+        i2c_applyClock();
+        uart_setBaud(uart_getBaud());
+        tone_applyClock();
+    }
+} // end clock_set
+
+unsigned char clock_level(void) {
+    return level;
+} // end clock_level
@@ -0,0 +1,65 @@
+/*
+ * clock.h
+ *
+ * DCO speed levels. The main loop runs at CLOCK_BOOST while it has work
+ * (redraws, link frames, the built-in opponent's search) and drops to
+ * CLOCK_IDLE before it sleeps: LPM0 keeps the DCO running for SMCLK, and
+ * a slower DCO draws less.
+ *
+ * The boost only speeds up the CPU's own work: the search, rendering and
+ * queueing. At 8 MHz SMCLK stays at 1 MHz (DCO/8), and the buses run at
+ * their set rates at every level anyway (SCL at I2C_SCL_HZ, the UART at
+ * the link's baud rate), so a redraw that waits on the I2C queue takes as
+ * long as before. Keeping SMCLK at the DCO rate instead would gain no bus
+ * time and would make every switch reprogram the UART under a frame
+ * being received.
+ *
+ * Everything clocked from SMCLK is derived below from CLOCK_SMCLK_HZ():
+ * the UART dividers, the I2C clock, the Timer0_A tick and scan counts and
+ * the buzzer periods. The drivers keep one value per level, built at
+ * compile time, and clock_set() re-applies them when SMCLK changes.
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+/* ====================================================================
+ * Clock Levels (MCLK = DCO, SMCLK = DCO/1 at 1 MHz and DCO/8 above, the
+ * largest divider, so SMCLK only changes on the way to 16 MHz)
+ * ==================================================================== */
+#define CLOCK_1MHZ          0
+#define CLOCK_8MHZ          1
+#define CLOCK_16MHZ         2
+#define CLOCK_LEVELS        3
+
+#define CLOCK_MCLK_HZ(level)    ((level) == CLOCK_16MHZ ? 16000000UL : (level) == CLOCK_8MHZ ? 8000000UL : 1000000UL)
+#define CLOCK_SMCLK_SHIFT(level) ((level) == CLOCK_1MHZ ? 0 : 3)        // DIVSx
+#define CLOCK_SMCLK_HZ(level)   (CLOCK_MCLK_HZ(level) >> CLOCK_SMCLK_SHIFT(level))
+
+#ifndef CLOCK_IDLE
+#define CLOCK_IDLE          CLOCK_1MHZ                                  // while the main loop sleeps
+#endif
+
+#ifndef CLOCK_BOOST
+#define CLOCK_BOOST         CLOCK_8MHZ                                  // while it has work; 16 MHz waits for both buses on every switch
+#endif
+
+/* ====================================================================
+ * Derived Timing
+ * ==================================================================== */
+#define CLOCK_DIVIDE(level, hz)         ((CLOCK_SMCLK_HZ(level) + (hz) / 2) / (hz))     // SMCLK periods per period at hz, rounded
+#define CLOCK_TIMER_COUNTS(level, ms)   ((ms) * (CLOCK_SMCLK_HZ(level) / 8000))         // Timer0_A counts at SMCLK/8
+
+// USCI_A0 low-frequency baud generator: UCBRx whole periods per bit, UCBRSx the remainder in eighths
+#define CLOCK_UART_BR(level, baud)      (CLOCK_SMCLK_HZ(level) / (baud))
+#define CLOCK_UART_EIGHTHS(level, baud) ((CLOCK_SMCLK_HZ(level) * 16 / (baud) + 1) / 2 - CLOCK_UART_BR(level, baud) * 8)
+#define CLOCK_UART_BRS(level, baud)     (CLOCK_UART_EIGHTHS(level, baud) > 7 ? 7 : CLOCK_UART_EIGHTHS(level, baud))
+
+/* ====================================================================
+ * Clock Prototype Definitions
+ * ==================================================================== */
+void clock_init(void);
+void clock_set(unsigned char);
+unsigned char clock_level(void);
+
+#endif /* CLOCK_H_ */
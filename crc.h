@@ -0,0 +1,13 @@
+/*
+ * crc.h
+ */
+
+#ifndef CRC_H_
+#define CRC_H_
+
+/* ====================================================================
+ * CRC Prototype Definitions
+ * ==================================================================== */
+unsigned char crc8(unsigned char, unsigned char);
+
+#endif /* CRC_H_ */
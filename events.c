@@ -0,0 +1,46 @@
+/*
+ * events.c
+ *
+ * Single-producer/single-consumer ring between interrupt context and the
+ * main loop. Interrupts do not nest on this part, so all ISRs together
+ * act as the one producer; the main loop is the only consumer. Each side
+ * owns one index, so no locking is needed.
+ */
+
+#include "events.h"
+
+static Event queue[EVENT_QUEUE_SIZE];
+static volatile unsigned char head = 0;                                 // written only by ISRs
+static volatile unsigned char tail = 0;                                 // written only by the main loop
+
+volatile unsigned int eventsDropped = 0;
+
+// ISR side: returns 0 and counts a drop if the queue is full
+unsigned char pushEvent(unsigned char type, unsigned char arg) {
+    unsigned char next = (head + 1) & (EVENT_QUEUE_SIZE - 1);
+
+    if (next == tail) {
+        eventsDropped++;
+        return 0;
+    }
+
+    queue[head].type = type;
+    queue[head].arg = arg;
+    head = next;                                                        // publish only after the slot is filled
+    return 1;
+} // end pushEvent
+
+// Main loop side: returns 0 if there is nothing to dispatch
+unsigned char popEvent(Event *event) {
+    if (tail == head) {
+        return 0;
+    }
+
+    *event = queue[tail];
+    tail = (tail + 1) & (EVENT_QUEUE_SIZE - 1);                         // release the slot only after copying it
+    return 1;
+} // end popEvent
+
+unsigned char eventPending(void) {
+    return tail != head;
+} // end eventPending
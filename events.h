@@ -0,0 +1,32 @@
+/*
+ * events.h
+ */
+
+#ifndef EVENTS_H_
+#define EVENTS_H_
+
+/* ====================================================================
+ * ISR to Main Loop Event Queue
+ * ==================================================================== */
+#define EVENT_QUEUE_SIZE    8                                           // must be a power of two
+
+#define EVENT_BUTTON        1                                           // arg: P1 bit of the pressed button
+#define EVENT_FRAME         2                                           // a complete UART message is waiting
+#define EVENT_TICK          3                                           // timer tick
+#define EVENT_TIMER         4                                           // a soft timer is due, run timer_run()
+
+typedef struct {
+    unsigned char type;
+    unsigned char arg;
+} Event;
+
+extern volatile unsigned int eventsDropped;
+
+/* ====================================================================
+ * Event Prototype Definitions
+ * ==================================================================== */
+unsigned char pushEvent(unsigned char, unsigned char);
+unsigned char popEvent(Event *);
+unsigned char eventPending(void);
+
+#endif /* EVENTS_H_ */
@@ -0,0 +1,194 @@
+/*
+ * game.c
+ *
+ * k-in-a-row rules on an N x N bitboard, one mask per player. A win can
+ * only be made by the marker just placed, so the check walks the four
+ * line directions out from that cell and stops after GAME_WIN_LENGTH - 1
+ * steps each way; its cost does not grow with the board. A draw is a
+ * full board without a win.
+ *
+ * The walk moves the cell's bit by shifts and stops at the side columns
+ * with constant edge masks; the top and bottom edges need no test, as the
+ * bit leaves the board there. No row or column is ever worked out: the
+ * G2553 has no hardware multiplier or divider, and this is the inner loop
+ * of the built-in opponent's search.
+ */
+
+#include "game.h"
+#include "crc.h"
+
+Board board;
+
+// Cells of one column, for any GAME_SIZE up to 5
+#define COLUMN_CELLS(column)    (GAME_BIT(column) | GAME_BIT(GAME_SIZE + (column)) | GAME_BIT(2 * GAME_SIZE + (column)) \
+                                 | (GAME_SIZE > 3 ? GAME_BIT(3 * GAME_SIZE + (column)) : 0) \
+                                 | (GAME_SIZE > 4 ? GAME_BIT(4 * GAME_SIZE + (column)) : 0))
+#define FIRST_COLUMN            COLUMN_CELLS(0)
+#define LAST_COLUMN             COLUMN_CELLS(GAME_SIZE - 1)
+
+static const unsigned char stepShift[4] = {1, GAME_SIZE, GAME_SIZE + 1, GAME_SIZE - 1};    // across, down, down-right, down-left
+static const GameMask forwardEdge[4] = {LAST_COLUMN, 0, LAST_COLUMN, FIRST_COLUMN};       // a step forward from these cells leaves the board
+static const GameMask backwardEdge[4] = {FIRST_COLUMN, 0, FIRST_COLUMN, LAST_COLUMN};
+
+// Markers of the mask in a row from a cell's bit in one direction, forward (down or right) or back, not counting the cell itself
+static unsigned char countRun(GameMask mask, GameMask bit, unsigned char direction, unsigned char forward) {
+    unsigned char shift = stepShift[direction];
+    GameMask edge = forward ? forwardEdge[direction] : backwardEdge[direction];
+    unsigned char run = 0;
+
+    while (run < GAME_WIN_LENGTH - 1 && !(bit & edge)) {
+        bit = forward ? bit << shift : bit >> shift;
+        if (!(mask & bit)) {
+            break;
+        }
+        run++;
+    }
+    return run;
+}
+
+void game_reset(void) {
+    board.x = 0;
+    board.o = 0;
+} // end game_reset
+
+// Marker in a cell, ' ' if empty
+char game_cell(unsigned char cell) {
+    GameMask bit = GAME_BIT(cell);
+
+    if (board.x & bit) {
+        return 'X';
+    }
+    if (board.o & bit) {
+        return 'O';
+    }
+    return ' ';
+} // end game_cell
+
+// Overwrite a cell with 'X', 'O' or ' ', used when resynchronising
+void game_set(unsigned char cell, char marker) {
+    GameMask bit = GAME_BIT(cell);
+
+    board.x &= ~bit;
+    board.o &= ~bit;
+    if (marker == 'X') {
+        board.x |= bit;
+    } else if (marker == 'O') {
+        board.o |= bit;
+    }
+} // end game_set
+
+// Place a marker in an empty cell, returns 0 if the cell is taken
+unsigned char game_place(unsigned char cell, char marker) {
+    GameMask bit = GAME_BIT(cell);
+
+    if ((board.x | board.o) & bit) {
+        return 0;
+    }
+    if (marker == 'X') {
+        board.x |= bit;
+    } else {
+        board.o |= bit;
+    }
+    return 1;
+} // end game_place
+
+GameMask game_emptyCells(void) {
+    return ~(board.x | board.o) & GAME_ALL_CELLS;
+} // end game_emptyCells
+
+// First empty cell after the given one, wrapping around; the cell itself if none is empty
+unsigned char game_nextEmpty(unsigned char cell) {
+    GameMask empty = game_emptyCells();
+    GameMask above = empty & ~((GAME_BIT(cell) << 1) - 1);              // empty cells past this one
+    GameMask candidates = above ? above : empty;
+    unsigned char next = 0;
+
+    if (!candidates) {
+        return cell;
+    }
+    while (!(candidates & 1)) {                                         // scan for the lowest set bit
+        candidates >>= 1;
+        next++;
+    }
+    return next;
+} // end game_nextEmpty
+
+// Does a player mask hold GAME_WIN_LENGTH in a row through the cell with the given bit?
+unsigned char game_completesLine(GameMask mask, GameMask bit) {
+    unsigned char direction;
+
+    for (direction = 0; direction < 4; direction++) {
+        if (1 + countRun(mask, bit, direction, 1) + countRun(mask, bit, direction, 0) >= GAME_WIN_LENGTH) {
+            return 1;
+        }
+    }
+    return 0;
+} // end game_completesLine
+
+// Outcome after a marker was placed in the given cell
+unsigned char game_result(unsigned char cell) {
+    GameMask bit = GAME_BIT(cell);
+    GameMask mask = (board.x & bit) ? board.x : board.o;
+
+    if (game_completesLine(mask, bit)) {
+        return GAME_WIN;
+    }
+    if (!game_emptyCells()) {
+        return GAME_DRAW;
+    }
+    return GAME_ONGOING;
+} // end game_result
+
+// Cells that are part of a completed line of the player's, 0 if there is none
+GameMask game_winningLine(char player) {
+    GameMask mask = (player == 'X') ? board.x : board.o;
+    GameMask line = 0;
+    GameMask bit;
+
+    for (bit = 1; bit & GAME_ALL_CELLS; bit <<= 1) {
+        if ((mask & bit) && game_completesLine(mask, bit)) {
+            line |= bit;
+        }
+    }
+    return line;
+} // end game_winningLine
+
+// Pack the board two bits per cell (0 empty, 1 X, 2 O)
+void game_pack(unsigned char *packed) {
+    unsigned char cell;
+
+    for (cell = 0; cell < GAME_PACKED_SIZE; cell++) {
+        packed[cell] = 0;
+    }
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        GameMask bit = GAME_BIT(cell);
+        unsigned char code = (board.x & bit) ? 1 : (board.o & bit) ? 2 : 0;
+        packed[cell / 4] |= code << ((cell % 4) * 2);
+    }
+} // end game_pack
+
+// Take the markers of a packed board into this one. Its empty cells never clear a marker here; where both
+// boards hold different markers, the packed one is only taken if override is set
+void game_merge(const unsigned char *packed, unsigned char override) {
+    unsigned char cell;
+
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        unsigned char code = (packed[cell / 4] >> ((cell % 4) * 2)) & 0x03;
+        if (code != 0 && (override || game_cell(cell) == ' ')) {
+            game_set(cell, (code == 1) ? 'X' : 'O');
+        }
+    }
+} // end game_merge
+
+// 8-bit fingerprint of the board, sent with every move
+unsigned char game_hash(void) {
+    unsigned char packed[GAME_PACKED_SIZE];
+    unsigned char hash = 0;
+    unsigned char i;
+
+    game_pack(packed);
+    for (i = 0; i < GAME_PACKED_SIZE; i++) {
+        hash = crc8(hash, packed[i]);
+    }
+    return hash;
+} // end game_hash
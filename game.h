@@ -0,0 +1,67 @@
+/*
+ * game.h
+ */
+
+#ifndef GAME_H_
+#define GAME_H_
+
+/* ====================================================================
+ * Board Layout: cell = row * GAME_SIZE + column, one bit per cell.
+ * Both are build-time settings, e.g. -DGAME_SIZE=5 -DGAME_WIN_LENGTH=4,
+ * and both boards of a linked pair must be built with the same values.
+ * ==================================================================== */
+#ifndef GAME_SIZE
+#define GAME_SIZE           3                                           // cells per row and column
+#endif
+
+#ifndef GAME_WIN_LENGTH
+#define GAME_WIN_LENGTH     GAME_SIZE                                   // markers in a row needed to win
+#endif
+
+#if GAME_SIZE < 3 || GAME_SIZE > 5
+#error "GAME_SIZE must be 3 to 5: the board has to fit a 32-bit mask and the 6-bit cell of a packed move"
+#endif
+#if GAME_WIN_LENGTH < 3 || GAME_WIN_LENGTH > GAME_SIZE
+#error "GAME_WIN_LENGTH must be between 3 and GAME_SIZE"
+#endif
+
+#define GAME_CELLS          (GAME_SIZE * GAME_SIZE)
+#define GAME_PACKED_SIZE    ((GAME_CELLS + 3) / 4)                      // bytes for the board at two bits per cell
+
+#if GAME_CELLS <= 16
+typedef unsigned int GameMask;
+#else
+typedef unsigned long GameMask;
+#endif
+
+#define GAME_BIT(cell)      ((GameMask)1 << (cell))
+#define GAME_ALL_CELLS      ((GAME_BIT(GAME_CELLS - 1) - 1) << 1 | 1)   // mask with every cell set, without shifting past the top bit
+
+#define GAME_ONGOING        0
+#define GAME_WIN            1
+#define GAME_DRAW           2
+
+typedef struct {
+    GameMask x;                                                         // cells holding 'X'
+    GameMask o;                                                         // cells holding 'O'
+} Board;
+
+extern Board board;
+
+/* ====================================================================
+ * Game Prototype Definitions
+ * ==================================================================== */
+void game_reset(void);
+char game_cell(unsigned char);
+void game_set(unsigned char, char);
+unsigned char game_place(unsigned char, char);
+GameMask game_emptyCells(void);
+unsigned char game_nextEmpty(unsigned char);
+unsigned char game_completesLine(GameMask, GameMask);
+unsigned char game_result(unsigned char);
+GameMask game_winningLine(char);
+void game_pack(unsigned char *);
+void game_merge(const unsigned char *, unsigned char);
+unsigned char game_hash(void);
+
+#endif /* GAME_H_ */
@@ -0,0 +1,43 @@
+/*
+ * hal.h
+ *
+ * Board services the game needs besides the display, link, buzzer and
+ * sleep drivers: clocks, buttons, LED, the soft-timer tick and interrupt
+ * control.
+ * hal_msp430.c implements them on the G2553; host/hal_host.c does the
+ * same on Linux together with host versions of i2c.h, uart.h, tone.h and
+ * power.h, so the game runs off-target. Define HOST_BUILD for the host.
+ */
+
+#ifndef HAL_H_
+#define HAL_H_
+
+/* ====================================================================
+ * Buttons (the P1 bit of the button, see input.h for the events)
+ * ==================================================================== */
+#define HAL_BUTTON_1        0x01                                        // P1.0, navigate / choose X
+#define HAL_BUTTON_2        0x08                                        // P1.3, place / choose O
+
+#define HAL_SCAN_MS         5                                           // button sampling period while any is active
+
+#define HAL_TICK_MS         10                                          // soft-timer tick period
+
+/* ====================================================================
+ * HAL Prototype Definitions
+ * ==================================================================== */
+void hal_initClocks(void);
+void hal_initButtons(void);
+unsigned char hal_debounceActive(void);
+void hal_initLED(void);
+void hal_setLED(unsigned char);
+unsigned int hal_timerCount(void);
+void hal_startTick(void);
+void hal_stopTick(void);
+void hal_enableInterrupts(void);
+void hal_disableInterrupts(void);
+unsigned int hal_saveInterrupts(void);
+void hal_restoreInterrupts(unsigned int);
+void hal_startCycleCount(void);
+unsigned long hal_cycleCount(void);
+
+#endif /* HAL_H_ */
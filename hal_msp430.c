@@ -0,0 +1,180 @@
+/*
+ * hal_msp430.c
+ *
+ * MSP430G2553 back end of hal.h. Buttons on P1.0 and P1.3 interrupt on
+ * the falling edge only to start the scan: the Port_1 ISR turns the pin
+ * interrupts off and arms the scan tick, which samples both pins for
+ * input.c until they are released and settled, then hands back to the
+ * pin interrupts.
+ *
+ * Timer0_A free-runs from SMCLK/8: CCR0 is the soft-timer tick, CCR1
+ * the button scan tick. Each compare is only enabled while it is in
+ * use, and the main loop keeps SMCLK on (LPM0) while either is. Their
+ * counts follow the clock level, from the next compare after a switch.
+ */
+
+#include "hal.h"
+#include "clock.h"
+#include "events.h"
+#include "timer.h"
+#include "input.h"
+#include "trace.h"
+#include <msp430.h>
+
+#define BUTTONS         (HAL_BUTTON_1 + HAL_BUTTON_2)
+
+static const unsigned int tickCounts[CLOCK_LEVELS] = {                  // Timer0_A counts per soft-timer tick, per clock level
+    CLOCK_TIMER_COUNTS(CLOCK_1MHZ, HAL_TICK_MS),
+    CLOCK_TIMER_COUNTS(CLOCK_8MHZ, HAL_TICK_MS),
+    CLOCK_TIMER_COUNTS(CLOCK_16MHZ, HAL_TICK_MS)
+};
+
+static const unsigned int scanCounts[CLOCK_LEVELS] = {                  // ... per button scan tick
+    CLOCK_TIMER_COUNTS(CLOCK_1MHZ, HAL_SCAN_MS),
+    CLOCK_TIMER_COUNTS(CLOCK_8MHZ, HAL_SCAN_MS),
+    CLOCK_TIMER_COUNTS(CLOCK_16MHZ, HAL_SCAN_MS)
+};
+
+static volatile unsigned int cycleOverflows = 0;                        // Timer0_A wraps since hal_startCycleCount
+
+void hal_initClocks(void) {
+    WDTCTL = WDTPW | WDTHOLD;                                           // Stop watchdog timer
+    clock_init();                                                       // DCO at CLOCK_IDLE
+
+    TA0CCTL0 = 0;                                                       // Compares stay off until needed
+    TA0CCTL1 = 0;
+    TA0CTL = TASSEL_2 | ID_3 | MC_2 | TACLR;                            // SMCLK/8, continuous
+} // end hal_initClocks
+
+void hal_initButtons(void) {
+    P1DIR &= ~BUTTONS;                                                  // Set P1.0 and P1.3 as inputs
+    P1REN |= BUTTONS;                                                   // Enable pull-up/down resistors
+    P1OUT |= BUTTONS;                                                   // Configure as pull-ups
+    P1IES |= BUTTONS;                                                   // Trigger on high-to-low transition
+    P1IFG &= ~BUTTONS;                                                  // Clear interrupt flags
+    P1IE |= BUTTONS;                                                    // Enable interrupts for P1.0 and P1.3
+} // end hal_initButtons
+
+// Button scan running, which needs SMCLK to stay on
+unsigned char hal_debounceActive(void) {
+    return (TA0CCTL1 & CCIE) != 0;
+} // end hal_debounceActive
+
+void hal_initLED(void) {
+    P2DIR |= BIT3;                                                      // Set P2.3 as output for LED
+    P2OUT &= ~BIT3;                                                     // Turn off LED initially
+} // end hal_initLED
+
+// LED on while it is this board's turn
+void hal_setLED(unsigned char on) {
+    if (on) {
+        P2OUT |= BIT3;
+    } else {
+        P2OUT &= ~BIT3;
+    }
+} // end hal_setLED
+
+// Free-running count at SMCLK/8, for entropy and trace timestamps; it stops in LPM3
+unsigned int hal_timerCount(void) {
+    return TA0R;
+} // end hal_timerCount
+
+void hal_startTick(void) {
+    TA0CCR0 = TA0R + tickCounts[clock_level()];
+    TA0CCTL0 = CCIE;
+} // end hal_startTick
+
+void hal_stopTick(void) {
+    TA0CCTL0 = 0;
+} // end hal_stopTick
+
+void hal_enableInterrupts(void) {
+    __enable_interrupt();
+} // end hal_enableInterrupts
+
+void hal_disableInterrupts(void) {
+    __disable_interrupt();
+} // end hal_disableInterrupts
+
+// Disable interrupts, returns the state for hal_restoreInterrupts (safe to nest, and from an ISR)
+unsigned int hal_saveInterrupts(void) {
+    unsigned int state = __get_interrupt_state();
+
+    __disable_interrupt();
+    return state;
+} // end hal_saveInterrupts
+
+void hal_restoreInterrupts(unsigned int state) {
+    __set_interrupt_state(state);
+} // end hal_restoreInterrupts
+
+// Benchmark clock: Timer0_A counts every SMCLK cycle from here on, and the
+// soft-timer and scan ticks run 8 times too fast, so only the bench uses it
+void hal_startCycleCount(void) {
+    cycleOverflows = 0;
+    TA0CTL = TASSEL_2 | MC_2 | TACLR | TAIE;                            // SMCLK/1, continuous, count wraps
+} // end hal_startCycleCount
+
+unsigned long hal_cycleCount(void) {
+    unsigned int state = hal_saveInterrupts();
+    unsigned int high = cycleOverflows;
+    unsigned int low = TA0R;
+
+    if ((TA0CTL & TAIFG) && low < 0x8000) {
+        high++;                                                         // wrapped, the ISR has not counted it yet
+    }
+    hal_restoreInterrupts(state);
+    return ((unsigned long)high << 16) | low;
+} // end hal_cycleCount
+
+// Button Interrupt Service Routine: an edge only starts the scan, input.c decides what it was
+#pragma vector=PORT1_VECTOR
+__interrupt void Port_1(void) {
+    TRACE_BEGIN(TRACE_ISR_PORT1);
+    P1IE &= ~BUTTONS;                                                   // The scan takes over until both are released
+    P1IFG &= ~BUTTONS;
+    TA0CCR1 = TA0R + scanCounts[clock_level()];                         // First sample one tick after the edge
+    TA0CCTL1 = CCIE;
+
+    __bic_SR_register_on_exit(LPM3_bits);                               // Back to sleep in LPM0, so Timer0_A counts
+    TRACE_END(TRACE_ISR_PORT1);
+}
+
+// Soft-timer tick: count, and wake the main loop only when a timer is due
+#pragma vector=TIMER0_A0_VECTOR
+__interrupt void Timer_A(void) {
+    TRACE_BEGIN(TRACE_ISR_TICK);
+    TA0CCR0 += tickCounts[clock_level()];                               // Next tick, without drift
+    if (timer_tick()) {
+        __bic_SR_register_on_exit(LPM3_bits);
+    }
+    TRACE_END(TRACE_ISR_TICK);
+}
+
+// Button scan tick on CCR1
+#pragma vector=TIMER0_A1_VECTOR
+__interrupt void Timer_A1(void) {
+    unsigned char wake;
+
+    switch (__even_in_range(TA0IV, TA0IV_TAIFG)) {
+        case TA0IV_TACCR1:
+            TRACE_BEGIN(TRACE_ISR_SCAN);
+            TA0CCR1 += scanCounts[clock_level()];
+            wake = input_scan(~P1IN & BUTTONS);                         // Pull-ups, a button down reads 0
+            if (input_idle()) {
+                TA0CCTL1 = 0;                                           // Stop scanning
+                P1IE |= BUTTONS;                                        // An edge flagged meanwhile comes straight back in
+                wake = 1;                                               // Let the main loop drop to a deeper sleep
+            }
+            if (wake) {
+                __bic_SR_register_on_exit(LPM3_bits);
+            }
+            TRACE_END(TRACE_ISR_SCAN);
+            break;
+        case TA0IV_TAIFG:
+            cycleOverflows++;                                           // Only enabled by hal_startCycleCount
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,276 @@
+/*
+ * bus_host.c
+ *
+ * Host versions of i2c.h and uart.h. Writes are counted and scheduled on
+ * a per-bus busy-until time at the real bit rate, so the CPU only waits
+ * once a backlog would overflow the driver's queue, or on a flush.
+ * Transfers to the display are also decoded by the SSD1306 model.
+ *
+ * On its own the UART is not connected to anything: bytes are sent into
+ * the void and none are ever received. A harness that runs a second board
+ * sets hostUartHook to carry each byte over, and feeds the other board's
+ * bytes back through host_receiveByte(); they are received at their
+ * arrival time by a copy of the uart.c receive state machine.
+ */
+
+#include "host.h"
+#include "i2c.h"
+#include "uart.h"
+#include "gram.h"
+#include "crc.h"
+#include "events.h"
+#include "trace.h"
+
+#define RX_HUNT     0                                                   // waiting for SYNC
+#define RX_LENGTH   1                                                   // next byte is LEN
+#define RX_PAYLOAD  2                                                   // collecting payload
+#define RX_CRC      3                                                   // next byte is the CRC
+
+typedef struct {
+    unsigned long long at;                                              // cycle the stop bit has arrived
+    unsigned char value;
+    unsigned char baud;                                                 // rate it was sent at
+} RxByte;
+
+static const unsigned long baudRates[] = {9600, 19200, 38400, 57600, 115200};
+
+volatile UartStats uartStats;
+I2CStats i2cStats;
+void (*hostUartHook)(unsigned long long, unsigned char, unsigned char) = 0;
+
+static unsigned long long i2cBusyUntil = 0;
+static unsigned char streamData[HOST_I2C_STREAM];                       // transaction being handed over by i2c_put
+static unsigned int streamAddress = 0;
+static unsigned int streamLength = 0;
+static unsigned int streamCount = 0;
+static unsigned long long uartBusyUntil = 0;
+static unsigned char baud = UART_BAUD_9600;
+
+static RxByte rxBytes[HOST_RX_BYTES];                                   // in arrival order
+static unsigned int rxBytesHead = 0;
+static unsigned int rxBytesTail = 0;
+static unsigned char rxFrames[HOST_RX_FRAMES][1 + UART_MAX_FRAME];      // LEN, then the payload
+static unsigned int rxFramesHead = 0;
+static unsigned int rxFramesTail = 0;
+static unsigned char rxState = RX_HUNT;
+static unsigned char rxLength = 0;                                      // payload bytes still expected
+static unsigned char rxCrc = 0;
+
+// Queue a transfer of the given length on a bus, blocking while it would not fit in the driver's ring
+static void schedule(unsigned long long *busyUntil, unsigned long byteCycles, unsigned int bytes, unsigned int queueSize) {
+    if (*busyUntil < hostStats.cycles) {
+        *busyUntil = hostStats.cycles;
+    }
+    *busyUntil += (unsigned long long)bytes * byteCycles;
+
+    if (*busyUntil - hostStats.cycles > (unsigned long long)queueSize * byteCycles) {
+        host_waitUntil(*busyUntil - (unsigned long long)queueSize * byteCycles);
+    }
+}
+
+static void transmit(const unsigned char *data, unsigned int length) {
+    unsigned long byteCycles = 10 * HOST_MCLK_HZ / baudRates[baud];     // start, 8 data, stop
+    unsigned int i;
+
+    hostStats.uartTxBytes += length;
+    host_chargeCycles((unsigned long)length * HOST_UART_ISR_CYCLES);
+    for (i = 0; i < length; i++) {
+        if (hostUartHook) {
+            unsigned long long start = (uartBusyUntil > hostStats.cycles) ? uartBusyUntil : hostStats.cycles;
+            hostUartHook(start + byteCycles, data[i], baud);            // before any wait, so the other board cannot run past it
+        }
+        schedule(&uartBusyUntil, byteCycles, 1, UART_TX_SIZE);
+    }
+}
+
+// Count a whole transaction, decode it if it is for the display and schedule it on the bus
+static void transfer(unsigned int address, const unsigned char *data, unsigned int length) {
+    if (address == SSD1306_I2C_ADDRESS) {
+        gram_write(data, length);
+    }
+
+    hostStats.i2cTransactions++;
+    hostStats.i2cBytes += length + 1;                                   // address byte first
+    i2cStats.transactions++;
+    i2cStats.bytes += length + 1;
+    host_chargeCycles((unsigned long)(length + 1) * HOST_I2C_ISR_CYCLES);
+    schedule(&i2cBusyUntil, 9 * HOST_I2C_BIT_CYCLES, length + 1, I2C_QUEUE_SIZE);   // 8 bits and ACK
+}
+
+/* ====================================================================
+ * i2c.h
+ * ==================================================================== */
+void initI2C(void) {
+    i2cBusyUntil = 0;
+} // end initI2C
+
+void i2c_write(unsigned int address, const unsigned char *data, unsigned int length) {
+    TRACE_BEGIN(TRACE_I2C_WRITE);
+    transfer(address, data, length);
+    TRACE_END(TRACE_I2C_WRITE);
+} // end i2c_write
+
+// The transaction goes on the bus model once its last byte is in, which takes no simulated time after the first
+void i2c_begin(unsigned int address, unsigned int length) {
+    streamAddress = address;
+    streamLength = (length < HOST_I2C_STREAM) ? length : HOST_I2C_STREAM;
+    streamCount = 0;
+    if (streamLength == 0) {
+        transfer(address, streamData, 0);
+    }
+} // end i2c_begin
+
+void i2c_put(unsigned char byte) {
+    if (streamCount < streamLength) {
+        streamData[streamCount++] = byte;
+        if (streamCount == streamLength) {
+            transfer(streamAddress, streamData, streamLength);
+        }
+    }
+} // end i2c_put
+
+// Cycle the last queued I2C byte will have left, the moment the display shows it
+unsigned long long host_i2cIdleAt(void) {
+    return (i2cBusyUntil > hostStats.cycles) ? i2cBusyUntil : hostStats.cycles;
+} // end host_i2cIdleAt
+
+void i2c_flush(void) {
+    host_waitUntil(i2cBusyUntil);
+} // end i2c_flush
+
+/* ====================================================================
+ * uart.h
+ * ==================================================================== */
+void initUART(void) {
+    uartBusyUntil = 0;
+    baud = UART_BAUD_9600;
+    rxFramesHead = rxFramesTail = 0;
+    rxState = RX_HUNT;
+} // end initUART
+
+void uart_setBaud(unsigned char index) {
+    uart_flush();                                                       // as on the board, finish at the old rate
+    baud = index;
+    rxState = RX_HUNT;                                                  // and drop a frame cut off by the change
+} // end uart_setBaud
+
+unsigned char uart_getBaud(void) {
+    return baud;
+} // end uart_getBaud
+
+void uart_write(const unsigned char *data, unsigned int length) {
+    transmit(data, length);
+} // end uart_write
+
+void uart_sendFrame(const unsigned char *payload, unsigned char length) {
+    unsigned char frame[UART_MAX_FRAME + UART_FRAME_OVERHEAD];
+    unsigned char crc = crc8(0, length);
+    unsigned char i;
+
+    frame[0] = UART_SYNC;
+    frame[1] = length;
+    for (i = 0; i < length; i++) {
+        frame[i + 2] = payload[i];
+        crc = crc8(crc, payload[i]);
+    }
+    frame[length + 2] = crc;
+
+    transmit(frame, length + UART_FRAME_OVERHEAD);
+} // end uart_sendFrame
+
+unsigned char uart_readFrame(unsigned char *payload, unsigned char size) {
+    unsigned char *frame = rxFrames[rxFramesTail];
+    unsigned char length, i;
+
+    if (rxFramesTail == rxFramesHead) {
+        return 0;
+    }
+    length = (frame[0] < size) ? frame[0] : size;
+    for (i = 0; i < length; i++) {
+        payload[i] = frame[i + 1];
+    }
+    rxFramesTail = (rxFramesTail + 1) & (HOST_RX_FRAMES - 1);
+    return length;
+} // end uart_readFrame
+
+void uart_flush(void) {
+    host_waitUntil(uartBusyUntil);
+} // end uart_flush
+
+/* ====================================================================
+ * Receive side, used when a harness connects another board
+ * ==================================================================== */
+
+// Queue a byte from the other board, to be received at cycle at; bytes must come in arrival order
+void host_receiveByte(unsigned long long at, unsigned char value, unsigned char rate) {
+    unsigned int next = (rxBytesHead + 1) & (HOST_RX_BYTES - 1);
+
+    if (next == rxBytesTail) {
+        uartStats.overruns++;                                           // more in flight than a wire can hold
+        return;
+    }
+    rxBytes[rxBytesHead].at = at;
+    rxBytes[rxBytesHead].value = value;
+    rxBytes[rxBytesHead].baud = rate;
+    rxBytesHead = next;
+} // end host_receiveByte
+
+unsigned long long host_rxDue(void) {
+    return (rxBytesTail == rxBytesHead) ? HOST_NEVER : rxBytes[rxBytesTail].at;
+} // end host_rxDue
+
+// USCI0RX_ISR for the byte that has just arrived
+void host_rxInterrupt(void) {
+    RxByte byte = rxBytes[rxBytesTail];
+    unsigned char *frame = rxFrames[rxFramesHead];
+
+    rxBytesTail = (rxBytesTail + 1) & (HOST_RX_BYTES - 1);
+    TRACE_BEGIN(TRACE_ISR_USCI_RX);
+    host_chargeCycles(HOST_UART_ISR_CYCLES);
+
+    if (byte.baud != baud) {
+        uartStats.framingErrors++;                                      // sent at another rate, garbage on this side
+        rxState = RX_HUNT;
+        TRACE_END(TRACE_ISR_USCI_RX);
+        return;
+    }
+
+    switch (rxState) {
+        case RX_HUNT:
+            if (byte.value == UART_SYNC) {
+                rxState = RX_LENGTH;
+            }
+            break;
+        case RX_LENGTH:
+            if (byte.value == 0 || byte.value > UART_MAX_FRAME) {
+                uartStats.framingErrors++;
+                rxState = (byte.value == UART_SYNC) ? RX_LENGTH : RX_HUNT;
+            } else {
+                frame[0] = byte.value;
+                rxLength = byte.value;
+                rxCrc = crc8(0, byte.value);
+                rxState = RX_PAYLOAD;
+            }
+            break;
+        case RX_PAYLOAD:
+            frame[1 + frame[0] - rxLength] = byte.value;
+            rxCrc = crc8(rxCrc, byte.value);
+            if (--rxLength == 0) {
+                rxState = RX_CRC;
+            }
+            break;
+        case RX_CRC:
+            rxState = RX_HUNT;
+            if (byte.value != rxCrc) {
+                uartStats.crcErrors++;
+            } else if (((rxFramesHead + 1) & (HOST_RX_FRAMES - 1)) == rxFramesTail) {
+                uartStats.dropped++;                                    // reader is behind, lose this frame only
+            } else {
+                rxFramesHead = (rxFramesHead + 1) & (HOST_RX_FRAMES - 1);
+                uartStats.frames++;
+                pushEvent(EVENT_FRAME, 0);
+            }
+            break;
+    }
+    TRACE_END(TRACE_ISR_USCI_RX);
+} // end host_rxInterrupt
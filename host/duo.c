@@ -0,0 +1,655 @@
+/*
+ * duo.c
+ *
+ * Two gamepads on one simulated clock, joined by a 9600 baud cable. One
+ * process per board runs the firmware against the host back end; this
+ * process is the cable between them. It plays a stream of scripted games
+ * with random moves and reports how long each step of a move takes, from
+ * the select press to the marker on both displays, as p50/p99 over all
+ * moves.
+ *
+ * The boards take turns under a conservative scheduler: before its clock
+ * moves, a board says how far it wants to go and waits, and the board
+ * with the earliest request runs next. Bytes are forwarded as soon as
+ * they are sent, stamped with their arrival time, so no board ever runs
+ * past a byte meant for it. The runs are deterministic for a seed.
+ *
+ * With -d it plays one scripted game instead, with the cable cut while
+ * each board places a marker, so each misses the other's move and gives
+ * up on its own. The next move after the cable is back carries a board
+ * hash that does not match, and the resync has to leave both boards with
+ * both lost moves. The exit status says whether it did.
+ *
+ * The TRACE points double as probes: this is built with TRACE_ENABLED
+ * but without trace.c, and its trace_record() reports the events the
+ * stages are measured from. As in sim.c, the C code takes no time, so
+ * the stages show debounce, bus and wire time.
+ *
+ *   ./tictactoe-duo [-n games] [-s seed] [-d]
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "host.h"
+#include "hal.h"
+#include "link.h"
+#include "game.h"
+#include "gram.h"
+#include "trace.h"
+
+#define DUO_GAMES       1000                                            // games played unless -n says otherwise
+#define DUO_FIRST_MS    700                                             // first marker choice, once the boards have started
+#define DUO_CHOOSE_MS   600                                             // from the marker choice to the first move
+#define DUO_STEP_MS     250                                             // between cursor moves
+#define DUO_PLACE_MS    500                                             // from placing a marker to the next player's first press
+#define DUO_RESET_MS    1500                                            // from skipping the result to the next marker choice
+#define DUO_JITTER_MS   150                                             // up to this much longer, at random, so presses land at any phase
+#define DUO_GIVE_UP_MS  1500                                            // cut long enough for the link to drop a move after its retries
+
+#define MSG_WAIT        1                                               // board: may my clock move to at?
+#define MSG_BYTE        2                                               // value arrives at the other end at cycle at, sent at baud
+#define MSG_PROBE       3                                               // board: trace event value at cycle at
+#define MSG_GRANT       4                                               // harness: run up to cycle at
+#define MSG_DONE        5                                               // board: idle for good
+
+#define STAGES          8
+#define NONE            HOST_NEVER
+
+typedef struct {
+    unsigned char type;                                                 // MSG_*
+    unsigned char value;                                                // byte or probe ID
+    unsigned char baud;                                                 // UART_BAUD_* of a byte
+    unsigned long long at;
+    unsigned long long extra;                                           // probe: cycle the display has everything queued so far
+} Message;
+
+typedef struct {
+    unsigned long ms;
+    unsigned char button;                                               // HAL_BUTTON_*
+} Press;
+
+typedef struct {
+    unsigned long long at;
+    unsigned long long extra;
+    unsigned char id;                                                   // trace ID, TRACE_END_BIT on an end
+} Probe;
+
+typedef struct {
+    unsigned long long at;                                              // arrival of the CRC byte
+    unsigned char type;                                                 // LINK_* of the frame
+} Frame;
+
+typedef struct {
+    pid_t pid;
+    int toBoard;
+    int fromBoard;
+    unsigned char done;
+    unsigned long long request;                                         // cycle asked for in the last MSG_WAIT
+    unsigned long long earliestByte;                                    // arrival of the first byte forwarded since
+    Press *presses;                                                     // the board's script
+    unsigned int pressCount;
+    Probe *probes;
+    unsigned int probeCount;
+    Frame *frames;                                                      // frames this board sent, as decoded on the wire
+    unsigned int frameCount;
+    unsigned char wire[2 + UART_MAX_FRAME];                             // frame being decoded: LEN, payload, and the bytes seen
+    unsigned char wireState;
+    Board board;                                                        // game board the firmware ended with
+} Node;
+
+typedef struct {
+    unsigned long long pressAt;                                         // select press that placed the marker
+    unsigned char mover;                                                // board it was pressed on
+} Move;
+
+static const char *const stageNames[STAGES] = {
+    "select press -> placeMarker",
+    "placeMarker -> local pixels",
+    "placeMarker -> link_sendData",
+    "link_sendData -> remote RX frame",
+    "remote RX frame -> handleReceivedData",
+    "handleReceivedData -> remote pixels",
+    "select press -> local pixels",
+    "select press -> remote pixels",
+};
+
+static Node nodes[2];
+static Move *moves = NULL;
+static unsigned int moveCount = 0;
+static unsigned long seed = 1;
+static unsigned long long cutFrom = NONE;                               // bytes arriving from this cycle on are lost...
+static unsigned long long cutTo = NONE;                                 // ... until this one
+
+static int toHarness = -1;                                              // in a board process, pipes to this one
+static int fromHarness = -1;
+
+/* ====================================================================
+ * Helpers
+ * ==================================================================== */
+static void *grow(void *array, unsigned int count, size_t size) {
+    if ((count & (count - 1)) == 0) {                                   // at every power of two
+        array = realloc(array, (count ? count * 2 : 16) * size);
+        if (array == NULL) {
+            perror("realloc");
+            exit(2);
+        }
+    }
+    return array;
+}
+
+static unsigned long nextRandom(void) {
+    seed ^= seed << 13;                                                 // xorshift32
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    seed &= 0xFFFFFFFFUL;
+    return seed;
+}
+
+// A gap between two presses: at least ms, a little more at random
+static unsigned long gap(unsigned long ms) {
+    return ms + nextRandom() % DUO_JITTER_MS;
+}
+
+static void sendMessage(int fd, const Message *message) {
+    if (write(fd, message, sizeof(*message)) != (ssize_t)sizeof(*message)) {
+        _exit(1);                                                       // the other end is gone
+    }
+}
+
+static int receiveMessage(int fd, Message *message) {
+    size_t got = 0;
+
+    while (got < sizeof(*message)) {
+        ssize_t n = read(fd, (char *)message + got, sizeof(*message) - got);
+        if (n <= 0) {
+            return 0;
+        }
+        got += n;
+    }
+    return 1;
+}
+
+/* ====================================================================
+ * Board process side
+ * ==================================================================== */
+static unsigned long long boardSync(unsigned long long at) {
+    Message message = {MSG_WAIT, 0, 0, at, 0};
+
+    sendMessage(toHarness, &message);
+    while (receiveMessage(fromHarness, &message)) {
+        if (message.type == MSG_BYTE) {
+            host_receiveByte(message.at, message.value, message.baud);
+        } else if (message.type == MSG_GRANT) {
+            return message.at;
+        }
+    }
+    _exit(1);
+}
+
+static void boardSend(unsigned long long at, unsigned char value, unsigned char baud) {
+    Message message = {MSG_BYTE, value, baud, at, 0};
+
+    sendMessage(toHarness, &message);
+}
+
+// Only the events the stages are measured from go to the harness
+void trace_record(unsigned char id) {
+    Message message = {MSG_PROBE, id, 0, 0, 0};
+
+    switch (id) {
+        case TRACE_PLACE_MARKER:
+        case TRACE_PLACE_MARKER | TRACE_END_BIT:
+        case TRACE_LINK_SEND:
+        case TRACE_HANDLE_RX:
+        case TRACE_DRAW_CELL | TRACE_END_BIT:
+            break;
+        default:
+            return;
+    }
+    if (toHarness < 0) {
+        return;
+    }
+    message.at = hostStats.cycles;
+    message.extra = host_i2cIdleAt();
+    sendMessage(toHarness, &message);
+}
+
+void trace_dump(unsigned char type, void (*send)(const unsigned char *, unsigned char)) {
+    (void)type;                                                         // nobody asks over this cable
+    (void)send;
+}
+
+static void runNode(Node *node, int in, int out) {
+    Message done = {MSG_DONE, 0, 0, 0, 0};
+    unsigned int i;
+
+    fromHarness = in;
+    toHarness = out;
+    hostSyncHook = boardSync;
+    hostUartHook = boardSend;
+    for (i = 0; i < node->pressCount; i++) {
+        host_pressButton(node->presses[i].ms, node->presses[i].button, HOST_PRESS_MS);
+    }
+
+    game_reset();                                                       // forked with the board planGames left behind
+    gram_reset();
+    firmwareInit();
+    while (!hostIdle) {
+        firmwareStep();
+    }
+    done.at = board.x;                                                  // the board it ended with, for the drop test
+    done.extra = board.o;
+    sendMessage(toHarness, &done);
+    _exit(0);
+}
+
+/* ====================================================================
+ * Harness side
+ * ==================================================================== */
+static void press(unsigned char board, unsigned long ms, unsigned char button) {
+    Node *b = &nodes[board];
+
+    b->presses = grow(b->presses, b->pressCount, sizeof(Press));
+    b->presses[b->pressCount].ms = ms;
+    b->presses[b->pressCount].button = button;
+    b->pressCount++;
+}
+
+// Script the games, following the rules with a copy of the board so every select press lands on an empty cell
+static unsigned long planGames(unsigned int games) {
+    unsigned long ms = DUO_FIRST_MS;
+    unsigned int game;
+
+    for (game = 0; game < games; game++) {
+        unsigned char mover = game & 1;                                 // the boards take turns to choose X, and X opens
+        unsigned char cursor[2] = {0, 0};                               // resetGame puts the cursor top left
+        unsigned char result = GAME_ONGOING;
+
+        press(mover, ms, HAL_BUTTON_1);
+        ms += gap(DUO_CHOOSE_MS);
+        game_reset();
+
+        while (result == GAME_ONGOING) {
+            GameMask empty = game_emptyCells();
+            unsigned int count = 0, pick, cell;
+
+            for (cell = 0; cell < GAME_CELLS; cell++) {
+                count += (empty & GAME_BIT(cell)) != 0;
+            }
+            pick = nextRandom() % count;
+            for (cell = 0; !(empty & GAME_BIT(cell)) || pick--; cell++);
+
+            while (cursor[mover] != cell || !(empty & GAME_BIT(cursor[mover]))) {
+                press(mover, ms, HAL_BUTTON_1);                         // moveMarker steps to the next empty cell
+                ms += gap(DUO_STEP_MS);
+                cursor[mover] = game_nextEmpty(cursor[mover]);
+            }
+            press(mover, ms, HAL_BUTTON_2);
+
+            moves = grow(moves, moveCount, sizeof(Move));
+            moves[moveCount].pressAt = (unsigned long long)ms * (HOST_MCLK_HZ / 1000);
+            moves[moveCount].mover = mover;
+            moveCount++;
+
+            game_place(cell, (mover == (game & 1)) ? 'X' : 'O');
+            result = game_result(cell);
+            ms += gap(DUO_PLACE_MS);
+            if (result == GAME_ONGOING) {
+                mover ^= 1;
+            }
+        }
+
+        press(mover, ms, HAL_BUTTON_1);                                 // skip the result, both boards reset
+        ms += gap(DUO_RESET_MS);
+    }
+    return ms;
+}
+
+// One game in which the cable is cut while each board places a marker; returns the board both should end with
+static unsigned long planDropTest(Board *expected) {
+    unsigned long ms = DUO_FIRST_MS;
+
+    game_reset();
+    press(0, ms, HAL_BUTTON_1);                                         // board 0 plays X, board 1 O
+    ms += DUO_CHOOSE_MS;
+    press(0, ms, HAL_BUTTON_2);                                         // X in cell 0, delivered
+    game_place(0, 'X');
+    ms += DUO_PLACE_MS;
+
+    cutFrom = (unsigned long long)ms * (HOST_MCLK_HZ / 1000);
+    press(1, ms, HAL_BUTTON_1);                                         // O in cell 1, lost
+    press(1, ms + DUO_STEP_MS, HAL_BUTTON_2);
+    game_place(1, 'O');
+    press(0, ms, HAL_BUTTON_1);                                         // X in cell 2, lost; board 0 never saw cell 1 taken
+    press(0, ms + DUO_STEP_MS, HAL_BUTTON_1);
+    press(0, ms + 2 * DUO_STEP_MS, HAL_BUTTON_2);
+    game_place(2, 'X');
+    ms += 2 * DUO_STEP_MS + DUO_GIVE_UP_MS;
+    cutTo = (unsigned long long)ms * (HOST_MCLK_HZ / 1000);
+
+    press(1, ms, HAL_BUTTON_1);                                         // O in cell 3, its hash starts the resync
+    press(1, ms + DUO_STEP_MS, HAL_BUTTON_1);
+    press(1, ms + 2 * DUO_STEP_MS, HAL_BUTTON_2);
+    game_place(3, 'O');
+    ms += 2 * DUO_STEP_MS + DUO_RESET_MS;
+
+    *expected = board;
+    return ms;
+}
+
+// A board as one character per cell, '.' for an empty one
+static const char *boardText(const Board *cells) {
+    static char text[GAME_CELLS + 1];
+    unsigned int cell;
+
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        text[cell] = (cells->x & GAME_BIT(cell)) ? 'X' : (cells->o & GAME_BIT(cell)) ? 'O' : '.';
+    }
+    text[GAME_CELLS] = '\0';
+    return text;
+}
+
+// Follow the frames a board sends, to know when each arrives and what it is
+static void decodeWire(Node *board, unsigned long long at, unsigned char value) {
+    unsigned char *wire = board->wire;
+
+    switch (board->wireState) {
+        case 0:
+            board->wireState = (value == UART_SYNC);
+            break;
+        case 1:
+            wire[0] = value;                                            // LEN
+            wire[1] = 0;                                                // payload bytes seen
+            board->wireState = (value > 0 && value <= UART_MAX_FRAME) ? 2 : 0;
+            break;
+        case 2:
+            wire[2 + wire[1]++] = value;
+            if (wire[1] == wire[0]) {
+                board->wireState = 3;
+            }
+            break;
+        default:                                                        // CRC, the board's receiver will check it
+            board->frames = grow(board->frames, board->frameCount, sizeof(Frame));
+            board->frames[board->frameCount].at = at;
+            board->frames[board->frameCount].type = wire[2] >> 4;
+            board->frameCount++;
+            board->wireState = 0;
+            break;
+    }
+}
+
+// Take messages from a running board until it waits or stops
+static void serve(unsigned char index) {
+    Node *board = &nodes[index];
+    Node *other = &nodes[index ^ 1];
+    Message message;
+
+    while (receiveMessage(board->fromBoard, &message)) {
+        if (message.type == MSG_WAIT) {
+            board->request = message.at;
+            return;
+        } else if (message.type == MSG_BYTE) {
+            if (message.at >= cutFrom && message.at < cutTo) {
+                continue;                                               // the cable is cut
+            }
+            decodeWire(board, message.at, message.value);
+            if (!other->done) {
+                sendMessage(other->toBoard, &message);
+                if (message.at < other->earliestByte) {
+                    other->earliestByte = message.at;
+                }
+            }
+        } else if (message.type == MSG_PROBE) {
+            board->probes = grow(board->probes, board->probeCount, sizeof(Probe));
+            board->probes[board->probeCount].at = message.at;
+            board->probes[board->probeCount].extra = message.extra;
+            board->probes[board->probeCount].id = message.value;
+            board->probeCount++;
+        } else {
+            if (message.type == MSG_DONE) {
+                board->board.x = (GameMask)message.at;
+                board->board.o = (GameMask)message.extra;
+            }
+            break;
+        }
+    }
+    board->done = 1;
+}
+
+// Grant the earliest request until both boards have nothing left to do
+static void schedule(void) {
+    Message grant = {MSG_GRANT, 0, 0, 0, 0};
+    unsigned char i;
+
+    serve(0);
+    serve(1);
+    while (1) {
+        unsigned long long first = NONE;
+        int next = -1;
+
+        for (i = 0; i < 2; i++) {
+            unsigned long long at = (nodes[i].earliestByte < nodes[i].request) ? nodes[i].earliestByte : nodes[i].request;
+            if (!nodes[i].done && (next < 0 || at < first)) {
+                first = at;
+                next = i;
+            }
+        }
+        if (next < 0) {
+            return;
+        }
+        if (first == NONE) {
+            for (i = 0; i < 2; i++) {                                   // both asleep for good, nothing on the wire
+                if (!nodes[i].done) {
+                    grant.at = NONE;
+                    sendMessage(nodes[i].toBoard, &grant);
+                    serve(i);
+                }
+            }
+            return;
+        }
+
+        grant.at = first;
+        nodes[next].earliestByte = NONE;
+        sendMessage(nodes[next].toBoard, &grant);
+        serve(next);
+    }
+}
+
+// First probe with this ID at or after a cycle, NULL if there is none
+static const Probe *findProbe(const Node *board, unsigned char id, unsigned long long from) {
+    unsigned int low = 0, high = board->probeCount;
+
+    while (low < high) {
+        unsigned int middle = (low + high) / 2;
+        if (board->probes[middle].at < from) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    for (; low < board->probeCount; low++) {
+        if (board->probes[low].id == id) {
+            return &board->probes[low];
+        }
+    }
+    return NULL;
+}
+
+static const Frame *findFrame(const Node *board, unsigned char type, unsigned long long from) {
+    unsigned int i;
+
+    for (i = 0; i < board->frameCount; i++) {                           // moves are few, a scan will do
+        if (board->frames[i].at >= from && board->frames[i].type == type) {
+            return &board->frames[i];
+        }
+    }
+    return NULL;
+}
+
+// Times of each stage of a move, returns 0 if part of it never happened
+static int measureMove(const Move *move, unsigned long long *stage) {
+    const Node *local = &nodes[move->mover];
+    const Node *remote = &nodes[move->mover ^ 1];
+    const Probe *place, *placed, *localDraw, *send, *handle, *remoteDraw;
+    const Frame *frame;
+
+    if ((place = findProbe(local, TRACE_PLACE_MARKER, move->pressAt)) == NULL
+        || (placed = findProbe(local, TRACE_PLACE_MARKER | TRACE_END_BIT, place->at)) == NULL
+        || (send = findProbe(local, TRACE_LINK_SEND, place->at)) == NULL
+        || (frame = findFrame(local, LINK_MOVE, send->at)) == NULL
+        || (handle = findProbe(remote, TRACE_HANDLE_RX, frame->at)) == NULL
+        || (remoteDraw = findProbe(remote, TRACE_DRAW_CELL | TRACE_END_BIT, handle->at)) == NULL) {
+        return 0;
+    }
+    localDraw = findProbe(local, TRACE_DRAW_CELL | TRACE_END_BIT, place->at);
+    if (localDraw == NULL || localDraw->at > placed->at) {
+        localDraw = placed;                                             // nothing to redraw, done when placeMarker is
+    }
+
+    stage[0] = place->at - move->pressAt;
+    stage[1] = localDraw->extra - place->at;
+    stage[2] = send->at - place->at;
+    stage[3] = frame->at - send->at;
+    stage[4] = handle->at - frame->at;
+    stage[5] = remoteDraw->extra - handle->at;
+    stage[6] = localDraw->extra - move->pressAt;
+    stage[7] = remoteDraw->extra - move->pressAt;
+    return 1;
+}
+
+static int compareCycles(const void *a, const void *b) {
+    unsigned long long x = *(const unsigned long long *)a;
+    unsigned long long y = *(const unsigned long long *)b;
+
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples, in ms
+static double percentile(const unsigned long long *sorted, unsigned int count, unsigned int percent) {
+    unsigned int rank = (count * percent + 99) / 100;
+
+    return (double)sorted[rank ? rank - 1 : 0] * 1000.0 / HOST_MCLK_HZ;
+}
+
+static void report(unsigned int games, unsigned long ms) {
+    unsigned long long *samples[STAGES];
+    unsigned int measured = 0, i, s;
+
+    for (s = 0; s < STAGES; s++) {
+        samples[s] = malloc((moveCount ? moveCount : 1) * sizeof(unsigned long long));
+        if (samples[s] == NULL) {
+            perror("malloc");
+            exit(2);
+        }
+    }
+    for (i = 0; i < moveCount; i++) {
+        unsigned long long stage[STAGES];
+        if (measureMove(&moves[i], stage)) {
+            for (s = 0; s < STAGES; s++) {
+                samples[s][measured] = stage[s];
+            }
+            measured++;
+        }
+    }
+
+    printf("games            %10u over %.3f s simulated\n", games, ms / 1000.0);
+    printf("moves            %10u, %u measured end to end\n", moveCount, measured);
+    printf("frames           %10u and %u sent by each board\n", nodes[0].frameCount, nodes[1].frameCount);
+    if (measured == 0) {
+        return;
+    }
+    printf("\n%-40s %9s %9s %9s\n", "stage", "p50 ms", "p99 ms", "max ms");
+    for (s = 0; s < STAGES; s++) {
+        qsort(samples[s], measured, sizeof(unsigned long long), compareCycles);
+        printf("%-40s %9.3f %9.3f %9.3f\n", stageNames[s], percentile(samples[s], measured, 50),
+               percentile(samples[s], measured, 99), percentile(samples[s], measured, 100));
+        free(samples[s]);
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned int games = DUO_GAMES;
+    unsigned char dropTest = 0;
+    Board expected;
+    unsigned long ms;
+    int arg, i;
+
+    for (arg = 1; arg < argc && argv[arg][0] == '-' && argv[arg][1] != '\0' && argv[arg][2] == '\0'; arg++) {
+        if (argv[arg][1] == 'd') {
+            dropTest = 1;
+        } else if (argv[arg][1] == 'n' && arg + 1 < argc) {
+            games = (unsigned int)strtoul(argv[++arg], NULL, 10);
+        } else if (argv[arg][1] == 's' && arg + 1 < argc) {
+            seed = strtoul(argv[++arg], NULL, 10);
+        } else {
+            break;
+        }
+    }
+    if (arg != argc || games == 0 || seed == 0) {
+        fprintf(stderr, "usage: %s [-n games] [-s seed, not 0] [-d]\n", argv[0]);
+        return 2;
+    }
+
+    ms = dropTest ? planDropTest(&expected) : planGames(games);
+    for (i = 0; i < 2; i++) {
+        if (nodes[i].pressCount > HOST_MAX_PRESSES) {
+            fprintf(stderr, "%u presses for one board, rebuild with -DHOST_MAX_PRESSES=%u or more\n",
+                    nodes[i].pressCount, nodes[i].pressCount);
+            return 2;
+        }
+    }
+
+    fflush(stdout);
+    for (i = 0; i < 2; i++) {
+        int down[2], up[2];
+
+        if (pipe(down) < 0 || pipe(up) < 0) {
+            perror("pipe");
+            return 2;
+        }
+        nodes[i].request = NONE;
+        nodes[i].earliestByte = NONE;
+        nodes[i].pid = fork();
+        if (nodes[i].pid < 0) {
+            perror("fork");
+            return 2;
+        }
+        if (nodes[i].pid == 0) {
+            close(down[1]);
+            close(up[0]);
+            if (i == 1) {
+                close(nodes[0].toBoard);                                // keep only this board's own pipes open
+                close(nodes[0].fromBoard);
+            }
+            runNode(&nodes[i], down[0], up[1]);
+        }
+        close(down[0]);
+        close(up[1]);
+        nodes[i].toBoard = down[1];
+        nodes[i].fromBoard = up[0];
+    }
+
+    schedule();
+    for (i = 0; i < 2; i++) {
+        waitpid(nodes[i].pid, NULL, 0);
+    }
+    if (dropTest) {
+        int agree = 1;
+
+        printf("expected         %s\n", boardText(&expected));
+        for (i = 0; i < 2; i++) {
+            printf("board %d          %s\n", i, boardText(&nodes[i].board));
+            agree &= nodes[i].board.x == expected.x && nodes[i].board.o == expected.o;
+        }
+        printf("drop test        %s\n", agree ? "passed" : "FAILED");
+        return !agree;
+    }
+    report(games, ms);
+    return 0;
+}
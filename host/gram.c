@@ -0,0 +1,253 @@
+/*
+ * gram.c
+ *
+ * Software SSD1306 for the host build. Each I2C transfer starts with a
+ * control byte: Co = 0 makes the rest of the transfer commands or data
+ * (D/C#), Co = 1 covers just the next byte. Commands and their argument
+ * bytes are collected across transfers, since the single-command form
+ * sends one byte per transfer. Data goes to GDDRAM at the write pointer,
+ * which advances as the memory mode says.
+ *
+ * The panel is taken to be mounted the way the init sequence expects:
+ * with segment remap (0xA1) and COM scan decrement (0xC8), column 0 is at
+ * the left and page 0 at the top. Clearing either mirrors the frame.
+ */
+
+#include <stdio.h>
+#include "gram.h"
+
+GramState gram;
+
+static unsigned char command[7];                                        // command byte, then its arguments
+static unsigned char commandLength = 0;                                 // bytes collected so far
+static unsigned char commandNeeds = 0;                                  // bytes the command takes in all
+
+// Bytes a command takes, its own included
+static unsigned char commandSize(unsigned char code) {
+    switch (code) {
+        case SSD1306_MEMORYMODE:
+        case SSD1306_SETCONTRAST:
+        case SSD1306_CHARGEPUMP:
+        case SSD1306_SETMULTIPLEX:
+        case SSD1306_SETDISPLAYOFFSET:
+        case SSD1306_SETDISPLAYCLOCKDIV:
+        case SSD1306_SETPRECHARGE:
+        case SSD1306_SETCOMPINS:
+        case SSD1306_SETVCOMDETECT:
+            return 2;
+        case SSD1306_COLUMNADDR:
+        case SSD1306_PAGEADDR:
+        case SSD1306_SET_VERTICAL_SCROLL_AREA:
+            return 3;
+        case SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL:
+        case SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL:
+            return 6;
+        case SSD1306_RIGHT_HORIZONTAL_SCROLL:
+        case SSD1306_LEFT_HORIZONTAL_SCROLL:
+            return 7;
+        default:
+            return 1;
+    }
+}
+
+static void execute(void) {
+    unsigned char code = command[0];
+
+    if (code < 0x10) {                                                  // lower column nibble, page addressing
+        gram.column = (gram.column & 0xF0) | code;
+    } else if (code < 0x20) {                                           // upper column nibble, page addressing
+        gram.column = (gram.column & 0x0F) | ((code & 0x07) << 4);
+    } else if (code >= 0xB0 && code <= 0xB7) {                          // page start, page addressing
+        gram.page = code & 0x07;
+    } else if (code >= SSD1306_SETSTARTLINE && code < SSD1306_SETSTARTLINE + 64) {
+        gram.startLine = code & 0x3F;
+    } else {
+        switch (code) {
+            case SSD1306_MEMORYMODE:
+                gram.memoryMode = command[1] & 0x03;
+                break;
+            case SSD1306_COLUMNADDR:
+                gram.columnStart = gram.column = command[1] & 0x7F;
+                gram.columnEnd = command[2] & 0x7F;
+                break;
+            case SSD1306_PAGEADDR:
+                gram.pageStart = gram.page = command[1] & 0x07;
+                gram.pageEnd = command[2] & 0x07;
+                break;
+            case SSD1306_SEGREMAP:
+            case SSD1306_SEGREMAP | 0x1:
+                gram.segmentRemap = code & 0x01;
+                break;
+            case SSD1306_COMSCANINC:
+            case SSD1306_COMSCANDEC:
+                gram.comReverse = (code == SSD1306_COMSCANDEC);
+                break;
+            case SSD1306_SETDISPLAYOFFSET:
+                gram.offset = command[1] & 0x3F;
+                break;
+            case SSD1306_SETMULTIPLEX:
+                gram.multiplex = command[1] & 0x3F;
+                break;
+            case SSD1306_SETCONTRAST:
+                gram.contrast = command[1];
+                break;
+            case SSD1306_NORMALDISPLAY:
+            case SSD1306_INVERTDISPLAY:
+                gram.inverted = (code == SSD1306_INVERTDISPLAY);
+                break;
+            case SSD1306_DISPLAYALLON_RESUME:
+            case SSD1306_DISPLAYALLON:
+                gram.allOn = (code == SSD1306_DISPLAYALLON);
+                break;
+            case SSD1306_DISPLAYOFF:
+            case SSD1306_DISPLAYON:
+                gram.displayOn = (code == SSD1306_DISPLAYON);
+                break;
+            case SSD1306_ACTIVATE_SCROLL:
+            case SSD1306_DEACTIVATE_SCROLL:
+                gram.scrolling = (code == SSD1306_ACTIVATE_SCROLL);
+                break;
+            default:                                                    // timing and analog settings, no effect on the image
+                break;
+        }
+    }
+}
+
+static void commandByte(unsigned char value) {
+    gram.commands++;
+    if (commandLength == 0) {
+        commandNeeds = commandSize(value);
+    }
+    command[commandLength++] = value;
+    if (commandLength == commandNeeds) {
+        execute();
+        commandLength = 0;
+    }
+}
+
+static void dataByte(unsigned char value) {
+    gram.dataBytes++;
+    gram.ram[gram.page & 0x07][gram.column & 0x7F] = value;
+
+    if (gram.memoryMode == 2) {                                         // page addressing: column only, wraps in the page
+        gram.column = (gram.column + 1) & 0x7F;
+    } else if (gram.memoryMode == 1) {                                  // vertical: down the pages, then next column
+        if (gram.page++ >= gram.pageEnd) {
+            gram.page = gram.pageStart;
+            gram.column = (gram.column >= gram.columnEnd) ? gram.columnStart : gram.column + 1;
+        }
+    } else {                                                            // horizontal: along the columns, then next page
+        if (gram.column++ >= gram.columnEnd) {
+            gram.column = gram.columnStart;
+            gram.page = (gram.page >= gram.pageEnd) ? gram.pageStart : gram.page + 1;
+        }
+    }
+}
+
+// Power-on state of the controller
+void gram_reset(void) {
+    unsigned char page, column;
+
+    for (page = 0; page < GRAM_PAGES; page++) {
+        for (column = 0; column < SSD1306_LCDWIDTH; column++) {
+            gram.ram[page][column] = 0;
+        }
+    }
+    gram.memoryMode = 2;
+    gram.columnStart = gram.column = 0;
+    gram.columnEnd = SSD1306_LCDWIDTH - 1;
+    gram.pageStart = gram.page = 0;
+    gram.pageEnd = GRAM_PAGES - 1;
+    gram.segmentRemap = 0;
+    gram.comReverse = 0;
+    gram.startLine = 0;
+    gram.offset = 0;
+    gram.multiplex = SSD1306_LCDHEIGHT - 1;
+    gram.contrast = 0x7F;
+    gram.inverted = 0;
+    gram.allOn = 0;
+    gram.displayOn = 0;
+    gram.scrolling = 0;
+    gram.commands = 0;
+    gram.dataBytes = 0;
+    commandLength = 0;
+} // end gram_reset
+
+// Decode one I2C transfer to the display, address byte excluded
+void gram_write(const unsigned char *bytes, unsigned int length) {
+    unsigned int i = 0;
+
+    while (i < length) {
+        unsigned char control = bytes[i++];
+        unsigned char isData = control & 0x40;
+
+        if (control & 0x80) {                                           // Co = 1: one byte, then another control byte
+            if (i < length) {
+                if (isData) {
+                    dataByte(bytes[i]);
+                } else {
+                    commandByte(bytes[i]);
+                }
+                i++;
+            }
+            continue;
+        }
+
+        for (; i < length; i++) {                                       // Co = 0: the rest of the transfer
+            if (isData) {
+                dataByte(bytes[i]);
+            } else {
+                commandByte(bytes[i]);
+            }
+        }
+    }
+} // end gram_write
+
+// Pixel as the panel shows it, 1 if lit; x from the left, y from the top
+unsigned char gram_pixel(unsigned char x, unsigned char y) {
+    unsigned char com = gram.comReverse ? y : (SSD1306_LCDHEIGHT - 1) - y;
+    unsigned char column = gram.segmentRemap ? x : (SSD1306_LCDWIDTH - 1) - x;
+    unsigned char row = (com + gram.startLine + gram.offset) & 0x3F;
+    unsigned char lit;
+
+    if (!gram.displayOn || com > gram.multiplex) {
+        return 0;
+    }
+    lit = gram.allOn || ((gram.ram[row / 8][column] >> (row % 8)) & 1);
+    return lit ^ gram.inverted;
+} // end gram_pixel
+
+// Write the panel image as a binary PBM, lit pixels white as on the OLED
+int gram_savePbm(const char *path) {
+    FILE *file = fopen(path, "wb");
+    unsigned char x, y;
+
+    if (file == NULL) {
+        return 0;
+    }
+    fprintf(file, "P4\n%d %d\n", SSD1306_LCDWIDTH, SSD1306_LCDHEIGHT);
+    for (y = 0; y < SSD1306_LCDHEIGHT; y++) {
+        for (x = 0; x < SSD1306_LCDWIDTH; x += 8) {
+            unsigned char packed = 0;
+            unsigned char bit;
+            for (bit = 0; bit < 8; bit++) {
+                packed = (packed << 1) | !gram_pixel(x + bit, y);       // PBM 1 is black
+            }
+            fputc(packed, file);
+        }
+    }
+    return fclose(file) == 0;
+} // end gram_savePbm
+
+// 32-bit FNV-1a of the panel image, for comparing frames against committed ones
+unsigned long gram_hash(void) {
+    unsigned long hash = 2166136261UL;
+    unsigned char x, y;
+
+    for (y = 0; y < SSD1306_LCDHEIGHT; y++) {
+        for (x = 0; x < SSD1306_LCDWIDTH; x++) {
+            hash = ((hash ^ gram_pixel(x, y)) * 16777619UL) & 0xFFFFFFFFUL;
+        }
+    }
+    return hash;
+} // end gram_hash
@@ -0,0 +1,48 @@
+/*
+ * gram.h
+ */
+
+#ifndef GRAM_H_
+#define GRAM_H_
+
+#include "ssd1306.h"
+
+/* ====================================================================
+ * SSD1306 Model: every I2C transfer to the display is decoded into the
+ * controller's GDDRAM and registers, and frames are rendered the way the
+ * panel would show them.
+ * ==================================================================== */
+#define GRAM_PAGES          (SSD1306_LCDHEIGHT / 8)
+
+typedef struct {
+    unsigned char ram[GRAM_PAGES][SSD1306_LCDWIDTH];                    // GDDRAM, bit n of a byte is row page * 8 + n
+    unsigned char memoryMode;                                           // 0 horizontal, 1 vertical, 2 page addressing
+    unsigned char columnStart, columnEnd;                               // COLUMNADDR window
+    unsigned char pageStart, pageEnd;                                   // PAGEADDR window
+    unsigned char column, page;                                         // write pointer
+    unsigned char segmentRemap;                                         // 0xA1: column 127 drives SEG0
+    unsigned char comReverse;                                           // 0xC8: COM scan decrements
+    unsigned char startLine;                                            // RAM row shown on the first COM
+    unsigned char offset;                                               // 0xD3 vertical shift
+    unsigned char multiplex;                                            // COM lines in use, minus one
+    unsigned char contrast;
+    unsigned char inverted;                                             // 0xA7
+    unsigned char allOn;                                                // 0xA5
+    unsigned char displayOn;                                            // 0xAF
+    unsigned char scrolling;                                            // 0x2F seen, scrolling itself is not modelled
+    unsigned long commands;                                             // command bytes decoded, arguments included
+    unsigned long dataBytes;                                            // GDDRAM bytes written
+} GramState;
+
+extern GramState gram;
+
+/* ====================================================================
+ * GRAM Prototype Definitions
+ * ==================================================================== */
+void gram_reset(void);
+void gram_write(const unsigned char *, unsigned int);
+unsigned char gram_pixel(unsigned char, unsigned char);
+int gram_savePbm(const char *);
+unsigned long gram_hash(void);
+
+#endif /* GRAM_H_ */
@@ -0,0 +1,410 @@
+/*
+ * hal_host.c
+ *
+ * Host versions of hal.h, clock.h, power.h and tone.h. Interrupt sources become
+ * scheduled events on the simulated clock: scripted button presses that
+ * start the button scan as the Port_1 ISR does, the scan and soft-timer
+ * ticks, and WDT intervals that sample the sleep state and post
+ * EVENT_TICK on request. They fire whenever time moves forward, so presses land in the
+ * event queue while a driver waits just as they would on the board.
+ */
+
+#include "host.h"
+#include "hal.h"
+#include "clock.h"
+#include "power.h"
+#include "tone.h"
+#include "events.h"
+#include "timer.h"
+#include "input.h"
+#include "trace.h"
+
+#define NEVER       HOST_NEVER
+#define TICK_CYCLES ((unsigned long long)HAL_TICK_MS * (HOST_MCLK_HZ / 1000))
+#define SCAN_CYCLES ((unsigned long long)HAL_SCAN_MS * (HOST_MCLK_HZ / 1000))
+
+#define AWAKE       0
+#define LPM0        1
+#define LPM3        3
+
+typedef struct {
+    unsigned long long at;                                              // cycle the button goes down
+    unsigned long long until;                                           // cycle it comes back up
+    unsigned char button;                                               // HAL_BUTTON_*
+} Press;
+
+HostStats hostStats;
+unsigned char hostIdle = 0;
+void (*hostWaitHook)(void) = 0;
+unsigned long long (*hostSyncHook)(unsigned long long) = 0;
+
+volatile PowerStats powerStats;
+volatile unsigned char tickRequests = 0;
+
+static Press presses[HOST_MAX_PRESSES];                                 // in time order
+static unsigned int pressCount = 0;
+static unsigned int nextPress = 0;
+static unsigned int firstHeld = 0;                                      // presses before this one are all released
+
+static unsigned long long nextTick = HOST_TICK_CYCLES;
+static unsigned long long nextTimerTick = NEVER;                        // soft-timer tick, NEVER while stopped
+static unsigned long long nextScan = NEVER;                             // button scan tick, NEVER while the pins wait for an edge
+static unsigned char edgeWhileScanning = 0;                             // P1IFG set with the pin interrupts off
+static unsigned char scanStopped = 0;                                   // the scan ISR woke the loop to sleep deeper
+static unsigned long long buzzerUntil = 0;
+static const Note *lastNote = 0;                                        // last note queued
+static unsigned long long lastNoteAt = 0;                               // cycle it starts playing
+static unsigned char sleepMode = AWAKE;
+static unsigned char interruptsEnabled = 0;
+static unsigned char clockLevel = CLOCK_IDLE;
+
+// Move the clock forward, charging the time to the CPU if it is running
+static void accountTime(unsigned long long at) {
+    if (sleepMode == AWAKE) {
+        hostStats.awakeCycles += at - hostStats.cycles;
+    }
+    hostStats.cycles = at;
+}
+
+static void wdtInterrupt(void) {
+    TRACE_BEGIN(TRACE_ISR_WDT);
+    hostStats.ticks++;
+    if (sleepMode == AWAKE) {
+        powerStats.awakeSamples++;
+    } else if (sleepMode == LPM3) {
+        powerStats.lpm3Samples++;
+    } else {
+        powerStats.lpm0Samples++;
+    }
+
+    if (tickRequests) {
+        pushEvent(EVENT_TICK, 0);
+    }
+    TRACE_END(TRACE_ISR_WDT);
+}
+
+// Buttons held down right now
+static unsigned char buttonLevels(void) {
+    unsigned char levels = 0;
+    unsigned int i;
+
+    while (firstHeld < nextPress && presses[firstHeld].until <= hostStats.cycles) {
+        firstHeld++;
+    }
+    for (i = firstHeld; i < nextPress; i++) {
+        if (presses[i].until > hostStats.cycles) {
+            levels |= presses[i].button;
+        }
+    }
+    return levels;
+}
+
+static void portInterrupt(void) {
+    TRACE_BEGIN(TRACE_ISR_PORT1);
+    hostStats.buttonPresses++;
+    if (nextScan != NEVER) {
+        edgeWhileScanning = 1;
+    } else {
+        nextScan = hostStats.cycles + SCAN_CYCLES;
+    }
+    TRACE_END(TRACE_ISR_PORT1);
+}
+
+static void scanInterrupt(void) {
+    TRACE_BEGIN(TRACE_ISR_SCAN);
+    hostStats.scanTicks++;
+    host_chargeCycles(HOST_SCAN_ISR_CYCLES);
+    nextScan += SCAN_CYCLES;
+    input_scan(buttonLevels());
+    if (input_idle()) {
+        nextScan = NEVER;
+        scanStopped = 1;
+        if (edgeWhileScanning) {                                        // Port_1 comes straight back in
+            edgeWhileScanning = 0;
+            nextScan = hostStats.cycles + SCAN_CYCLES;
+        }
+    }
+    TRACE_END(TRACE_ISR_SCAN);
+}
+
+// Advance to the given cycle, running every interrupt that falls due on the way; a sleep (wake set) ends early
+// once an ISR has queued work, which only happens before at when a byte from the other board was not yet known
+static void runUntil(unsigned long long at, unsigned char wake) {
+    while (1) {
+        unsigned long long press = (nextPress < pressCount) ? presses[nextPress].at : NEVER;
+        unsigned long long due = (nextTick <= press) ? nextTick : press;
+        unsigned long long rx = host_rxDue();
+
+        if (nextTimerTick < due) {
+            due = nextTimerTick;
+        }
+        if (nextScan < due) {
+            due = nextScan;
+        }
+        if (rx < due) {
+            due = rx;
+        }
+        if (hostSyncHook) {
+            unsigned long long next = (due < at) ? due : at;
+            unsigned long long limit = (next > hostStats.cycles) ? hostSyncHook(next) : next;
+            if (limit < next) {
+                accountTime(limit);
+                continue;                                               // a byte from the other board falls due first
+            }
+        }
+        if (due > at) {
+            break;
+        }
+        accountTime(due);
+        if (due == nextTimerTick) {
+            nextTimerTick += TICK_CYCLES;
+            hostStats.timerTicks++;
+            host_chargeCycles(HOST_TICK_ISR_CYCLES);
+            TRACE_BEGIN(TRACE_ISR_TICK);
+            timer_tick();                                               // Timer0_A CCR0 ISR
+            TRACE_END(TRACE_ISR_TICK);
+        } else if (due == nextScan) {
+            scanInterrupt();
+        } else if (due == nextTick) {
+            nextTick += HOST_TICK_CYCLES;
+            wdtInterrupt();
+        } else if (due == rx) {
+            host_rxInterrupt();
+        } else {
+            nextPress++;
+            portInterrupt();
+        }
+        if (wake && due < at && eventPending()) {
+            return;
+        }
+    }
+    if (at > hostStats.cycles) {
+        accountTime(at);
+    }
+}
+
+// Earliest future time something would wake the main loop, NEVER if nothing will
+static unsigned long long nextWake(void) {
+    unsigned long long wake = (nextPress < pressCount) ? presses[nextPress].at : NEVER;
+
+    if (tickRequests && nextTick < wake) {
+        wake = nextTick;
+    }
+    if (nextTimerTick < wake) {
+        wake = nextTimerTick;                                           // only wakes the loop once a timer is due
+    }
+    if (nextScan < wake) {
+        wake = nextScan;                                                // only wakes the loop on an event or when it stops
+    }
+    if (buzzerUntil > hostStats.cycles && buzzerUntil < wake) {
+        wake = buzzerUntil;                                             // Timer1_A ISR wakes when playback ends
+    }
+    if (host_rxDue() < wake) {
+        wake = host_rxDue();                                            // only wakes the loop once a frame is complete
+    }
+    return wake;
+}
+
+// Queue a button press at a time in ms, held for holdMs; returns 0 if out of order or the script is full
+unsigned char host_pressButton(unsigned long ms, unsigned char button, unsigned int holdMs) {
+    unsigned long long at = (unsigned long long)ms * (HOST_MCLK_HZ / 1000);
+
+    if (pressCount == HOST_MAX_PRESSES || (pressCount > 0 && at < presses[pressCount - 1].at)) {
+        return 0;
+    }
+    presses[pressCount].at = at;
+    presses[pressCount].until = at + (unsigned long long)holdMs * (HOST_MCLK_HZ / 1000);
+    presses[pressCount].button = button;
+    pressCount++;
+    return 1;
+} // end host_pressButton
+
+// Wait for a peripheral to finish, asleep in LPM0 if interrupts are on as the drivers do
+void host_waitUntil(unsigned long long at) {
+    if (at <= hostStats.cycles) {
+        return;
+    }
+    if (interruptsEnabled) {
+        sleepMode = LPM0;
+    }
+    runUntil(at, 0);
+    sleepMode = AWAKE;
+} // end host_waitUntil
+
+// CPU time spent in interrupt handlers that the simulation does not run, given in cycles at 1 MHz
+void host_chargeCycles(unsigned long cycles) {
+    hostStats.awakeCycles += (unsigned long long)cycles * HOST_MCLK_HZ / CLOCK_MCLK_HZ(clockLevel);
+} // end host_chargeCycles
+
+/* ====================================================================
+ * hal.h
+ * ==================================================================== */
+void hal_initClocks(void) {
+    clock_init();
+} // end hal_initClocks
+
+void hal_initButtons(void) {
+    nextScan = NEVER;
+    edgeWhileScanning = 0;
+} // end hal_initButtons
+
+unsigned char hal_debounceActive(void) {
+    return nextScan != NEVER;
+} // end hal_debounceActive
+
+void hal_initLED(void) {
+} // end hal_initLED
+
+void hal_setLED(unsigned char on) {
+    (void)on;
+} // end hal_setLED
+
+unsigned int hal_timerCount(void) {
+    return (unsigned int)(hostStats.cycles / 8);                       // TA0R, SMCLK/8
+} // end hal_timerCount
+
+void hal_startTick(void) {
+    nextTimerTick = hostStats.cycles + TICK_CYCLES;
+} // end hal_startTick
+
+void hal_stopTick(void) {
+    nextTimerTick = NEVER;
+} // end hal_stopTick
+
+void hal_enableInterrupts(void) {
+    interruptsEnabled = 1;
+} // end hal_enableInterrupts
+
+void hal_disableInterrupts(void) {
+    interruptsEnabled = 0;
+} // end hal_disableInterrupts
+
+unsigned int hal_saveInterrupts(void) {
+    unsigned int state = interruptsEnabled;
+
+    interruptsEnabled = 0;
+    return state;
+} // end hal_saveInterrupts
+
+void hal_restoreInterrupts(unsigned int state) {
+    interruptsEnabled = (unsigned char)state;
+} // end hal_restoreInterrupts
+
+void hal_startCycleCount(void) {
+} // end hal_startCycleCount
+
+unsigned long hal_cycleCount(void) {
+    return (unsigned long)hostStats.cycles;                             // bus and sleep time, the C code itself is free
+} // end hal_cycleCount
+
+/* ====================================================================
+ * power.h
+ * ==================================================================== */
+void initPowerStats(void) {
+    nextTick = hostStats.cycles + HOST_TICK_CYCLES;
+} // end initPowerStats
+
+// Sleep until the next interrupt that wakes the main loop; sets hostIdle if none ever will
+void enterLowPower(unsigned char needSMCLK) {
+    unsigned long long stopAt = (pressCount > 0) ? presses[pressCount - 1].at : 0;
+    unsigned long long wake;
+
+    stopAt += (unsigned long long)HOST_RUN_ON_MS * (HOST_MCLK_HZ / 1000);
+    if (hostSyncHook) {
+        stopAt = NEVER;                                                 // run until the other board has gone quiet as well
+    }
+    powerStats.wakeups++;
+    runUntil(hostStats.cycles + HOST_PASS_CYCLES * HOST_MCLK_HZ / CLOCK_MCLK_HZ(clockLevel), 0);    // the pass that ends here
+    if (hostWaitHook) {
+        hostWaitHook();
+    }
+    interruptsEnabled = 1;                                              // enabled atomically with the sleep
+
+    sleepMode = needSMCLK ? LPM0 : LPM3;
+    scanStopped = 0;
+    while (!eventPending()) {
+        wake = nextWake();
+        if (wake == NEVER && hostSyncHook) {
+            wake = hostSyncHook(NEVER);                                 // only the other board can wake this one now
+        }
+        if (wake == NEVER || wake > stopAt) {
+            hostIdle = 1;
+            break;
+        }
+        runUntil(wake, 1);
+        if (scanStopped || wake == buzzerUntil) {
+            break;                                                      // woken without an event, loop picks a new mode
+        }
+    }
+    sleepMode = AWAKE;
+} // end enterLowPower
+
+// Exact on the host, from the cycles charged to the CPU, where the board can only sample
+unsigned int awakePermille(void) {
+    if (hostStats.cycles == 0) {
+        return 0;
+    }
+    return (unsigned int)((hostStats.awakeCycles * 1000 + hostStats.cycles / 2) / hostStats.cycles);
+} // end awakePermille
+
+void requestTicks(unsigned char mask) {
+    tickRequests |= mask;
+} // end requestTicks
+
+void releaseTicks(unsigned char mask) {
+    tickRequests &= ~mask;
+} // end releaseTicks
+
+/* ====================================================================
+ * clock.h: the level only scales the ISR cost estimates, the simulated
+ * clock counts 1 MHz cycles throughout
+ * ==================================================================== */
+void clock_init(void) {
+    clockLevel = CLOCK_IDLE;
+} // end clock_init
+
+void clock_set(unsigned char to) {
+    clockLevel = to;
+} // end clock_set
+
+unsigned char clock_level(void) {
+    return clockLevel;
+} // end clock_level
+
+/* ====================================================================
+ * tone.h: notes only take up time, nothing is heard
+ * ==================================================================== */
+void initBuzzer(void) {
+    buzzerUntil = 0;
+    lastNote = 0;
+} // end initBuzzer
+
+unsigned char playMelody(const Note *notes, unsigned char count) {
+    unsigned long long at = (buzzerUntil > hostStats.cycles) ? buzzerUntil : hostStats.cycles;
+    unsigned char i;
+
+    for (i = 0; i < count; i++) {
+        lastNote = &notes[i];
+        lastNoteAt = at;
+        at += (unsigned long long)notes[i].duration * (HOST_MCLK_HZ / 1000);
+    }
+    buzzerUntil = at;
+    hostStats.notes += count;
+    return count;
+} // end playMelody
+
+unsigned char playNote(const Note *note) {
+    if (note == lastNote && lastNoteAt > hostStats.cycles) {
+        return 1;                                                       // still waiting behind the one playing
+    }
+    return playMelody(note, 1);
+} // end playNote
+
+void stopBuzzer(void) {
+    buzzerUntil = hostStats.cycles;
+    lastNote = 0;
+} // end stopBuzzer
+
+unsigned char buzzerBusy(void) {
+    return hostStats.cycles < buzzerUntil;
+} // end buzzerBusy
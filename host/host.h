@@ -0,0 +1,74 @@
+/*
+ * host.h
+ *
+ * Linux back end of the firmware. Simulated time advances only through
+ * bus transfers, delays and sleeps, in MCLK cycles at the board's 1 MHz,
+ * so a run is deterministic. The C code itself is taken to run in zero
+ * time; the ISR costs below are rough per-byte estimates that show up in
+ * the awake time only. Each pass of the main loop is charged
+ * HOST_PASS_CYCLES of real time before it sleeps, so the WDT can find the
+ * CPU awake and the clock moves on as it would on the board.
+ */
+
+#ifndef HOST_H_
+#define HOST_H_
+
+/* ====================================================================
+ * Simulation Settings
+ * ==================================================================== */
+#define HOST_MCLK_HZ            1000000UL                               // simulated cycles, CLOCK_1MHZ; faster levels only shorten ISR costs
+#define HOST_TICK_CYCLES        43000UL                                 // WDT interval, ACLK/512 from a ~12 kHz VLO
+#define HOST_I2C_BIT_CYCLES     10                                      // SCL = SMCLK/10
+#define HOST_I2C_ISR_CYCLES     30                                      // TX ISR per I2C byte, estimated
+#define HOST_UART_ISR_CYCLES    30                                      // TX ISR per UART byte, estimated
+#define HOST_TICK_ISR_CYCLES    25                                      // soft-timer tick ISR, estimated
+#define HOST_SCAN_ISR_CYCLES    60                                      // button scan ISR, estimated
+#define HOST_PASS_CYCLES        400                                     // main loop pass: wake, dispatch and handler, estimated
+#define HOST_PRESS_MS           100                                     // how long a scripted press is held by default
+#ifndef HOST_MAX_PRESSES
+#define HOST_MAX_PRESSES        256                                     // scripted button presses
+#endif
+#define HOST_RUN_ON_MS          10000                                   // keep simulating after the last press
+#define HOST_RX_BYTES           256                                     // bytes from the other board not yet received, must be a power of two
+#define HOST_RX_FRAMES          8                                       // received frames not yet read, must be a power of two
+#define HOST_I2C_STREAM         1024                                    // longest transaction opened with i2c_begin
+
+#define HOST_NEVER              (~0ULL)                                 // a cycle nothing is scheduled for
+
+typedef struct {
+    unsigned long long cycles;                                          // simulated time since reset
+    unsigned long long awakeCycles;                                     // ... of which the CPU was running
+    unsigned long i2cBytes;                                             // bytes on the I2C bus, address bytes included
+    unsigned long i2cTransactions;
+    unsigned long uartTxBytes;                                          // bytes sent, frame overhead included
+    unsigned long buttonPresses;                                        // scripted presses
+    unsigned long scanTicks;                                            // button scan samples taken
+    unsigned long notes;                                                // buzzer notes queued
+    unsigned long ticks;                                                // WDT intervals elapsed
+    unsigned long timerTicks;                                           // soft-timer ticks taken
+} HostStats;
+
+extern HostStats hostStats;
+extern unsigned char hostIdle;                                          // nothing left that could wake the firmware
+extern void (*hostWaitHook)(void);                                      // called whenever the firmware stops to wait
+
+/* Connecting a second board: both hooks are 0 while the UART is left open */
+extern unsigned long long (*hostSyncHook)(unsigned long long);         // before the clock moves: how far it may go towards a cycle, HOST_NEVER to stop
+extern void (*hostUartHook)(unsigned long long, unsigned char, unsigned char);  // per byte sent: cycle it has arrived at the far end, value, UART_BAUD_*
+
+/* ====================================================================
+ * Host Prototype Definitions
+ * ==================================================================== */
+unsigned char host_pressButton(unsigned long, unsigned char, unsigned int);
+void host_waitUntil(unsigned long long);
+void host_chargeCycles(unsigned long);
+void host_receiveByte(unsigned long long, unsigned char, unsigned char);
+unsigned long long host_rxDue(void);
+void host_rxInterrupt(void);
+unsigned long long host_i2cIdleAt(void);
+
+/* Supplied by main.c when built with HOST_BUILD */
+void firmwareInit(void);
+void firmwareStep(void);
+
+#endif /* HOST_H_ */
@@ -0,0 +1,234 @@
+/*
+ * sim.c
+ *
+ * Runs the firmware on Linux from a script of button presses and prints
+ * what it cost: simulated time, CPU awake time, bus traffic and power
+ * samples. Script lines are "<time in ms> <button 1 or 2> [hold in ms]",
+ * in time order; '#' starts a comment. The run ends once nothing is left that
+ * could wake the firmware, or HOST_RUN_ON_MS after the last press.
+ *
+ * Display traffic is decoded by the SSD1306 model. Whenever the firmware
+ * stops to wait after talking to the display, that closes a frame; -f
+ * writes each frame as <prefix>NNNN.pbm and lists its bus bytes.
+ *
+ * -g writes a hash of each frame's image to a golden file, and -c checks
+ * the frames against one: a frame that differs, or one too many or too
+ * few, is reported on stderr and the run exits with status 1. The golden
+ * file for host/demo.txt is host/demo.frames.
+ *
+ * In a TRACE_ENABLED build, -t writes the trace ring at the end of the run
+ * as the UART bytes a board sends on LINK_TRACE, for tools/trace2json.c.
+ *
+ *   ./tictactoe-host [-f prefix] [-t trace.bin] [-g|-c golden] host/demo.txt
+ */
+
+#include <stdio.h>
+#include "host.h"
+#include "hal.h"
+#include "power.h"
+#include "link.h"
+#include "events.h"
+#include "gram.h"
+#include "crc.h"
+#include "trace.h"
+
+static const char *framePrefix = NULL;                                  // -f, NULL to keep frames to the totals
+static unsigned int frames = 0;
+static unsigned long frameBytesMax = 0;
+static unsigned long frameStartBytes = 0;                               // hostStats.i2cBytes when the frame began
+static FILE *traceFile = NULL;                                          // -t
+static FILE *goldenFile = NULL;                                         // -g or -c
+static unsigned char goldenWrite = 0;                                   // -g: record the hashes instead of checking them
+static unsigned int goldenMismatches = 0;
+
+// Next frame number and hash from the golden file, 0 at its end
+static int readGolden(unsigned int *frame, unsigned long *hash) {
+    char text[80];
+
+    while (fgets(text, sizeof(text), goldenFile)) {
+        char first;
+
+        if (sscanf(text, " %c", &first) != 1 || first == '#') {
+            continue;                                                   // blank or comment
+        }
+        if (sscanf(text, "%u %lx", frame, hash) == 2) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Record or check the frame just closed
+static void checkFrame(void) {
+    unsigned long hash = gram_hash();
+    unsigned long expected;
+    unsigned int frame;
+
+    if (goldenWrite) {
+        fprintf(goldenFile, "%04u %08lx\n", frames, hash);
+    } else if (!readGolden(&frame, &expected) || frame != frames) {
+        fprintf(stderr, "frame %u at %.3f s: not in the golden file\n", frames, (double)hostStats.cycles / HOST_MCLK_HZ);
+        goldenMismatches++;
+    } else if (hash != expected) {
+        fprintf(stderr, "frame %u at %.3f s: hash %08lx, golden %08lx\n", frames, (double)hostStats.cycles / HOST_MCLK_HZ,
+                hash, expected);
+        goldenMismatches++;
+    }
+}
+
+// Close the frame if the display was written since the last one
+static void endFrame(void) {
+    unsigned long bytes = hostStats.i2cBytes - frameStartBytes;
+    char path[256];
+
+    if (bytes == 0) {
+        return;
+    }
+    frameStartBytes = hostStats.i2cBytes;
+    frames++;
+    if (bytes > frameBytesMax) {
+        frameBytesMax = bytes;
+    }
+
+    if (goldenFile) {
+        checkFrame();
+    }
+    if (framePrefix) {
+        snprintf(path, sizeof(path), "%s%04u.pbm", framePrefix, frames);
+        if (!gram_savePbm(path)) {
+            perror(path);
+        }
+        printf("frame %4u  %9.3f s  %6lu bytes  %s\n", frames, (double)hostStats.cycles / HOST_MCLK_HZ, bytes, path);
+    }
+}
+
+#ifdef TRACE_ENABLED
+// Frame a trace payload as uart_sendFrame would put it on the wire
+static void writeTraceFrame(const unsigned char *payload, unsigned char length) {
+    unsigned char crc = crc8(0, length);
+    unsigned char i;
+
+    fputc(UART_SYNC, traceFile);
+    fputc(length, traceFile);
+    for (i = 0; i < length; i++) {
+        fputc(payload[i], traceFile);
+        crc = crc8(crc, payload[i]);
+    }
+    fputc(crc, traceFile);
+}
+#endif
+
+static int loadScript(FILE *file) {
+    char text[80];
+    unsigned int line = 0;
+
+    while (fgets(text, sizeof(text), file)) {
+        unsigned long ms;
+        unsigned int button;
+        unsigned int hold = HOST_PRESS_MS;
+        char extra;
+
+        line++;
+        if (sscanf(text, " %c", &extra) != 1 || extra == '#') {
+            continue;                                                   // blank or comment
+        }
+        if (sscanf(text, "%lu %u %u", &ms, &button, &hold) < 2 || button < 1 || button > 2
+            || !host_pressButton(ms, (button == 1) ? HAL_BUTTON_1 : HAL_BUTTON_2, hold)) {
+            fprintf(stderr, "script line %u: expected \"<ms> <1|2> [hold ms]\" in time order\n", line);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    FILE *script = stdin;
+
+    const char *tracePath = NULL;
+    const char *goldenPath = NULL;
+    int arg = 1;
+
+    while (arg + 1 < argc && argv[arg][0] == '-' && argv[arg][1] != '\0' && argv[arg][2] == '\0') {
+        if (argv[arg][1] == 'f') {
+            framePrefix = argv[arg + 1];
+        } else if (argv[arg][1] == 't') {
+            tracePath = argv[arg + 1];
+        } else if (argv[arg][1] == 'g' || argv[arg][1] == 'c') {
+            goldenPath = argv[arg + 1];
+            goldenWrite = (argv[arg][1] == 'g');
+        } else {
+            break;
+        }
+        arg += 2;
+    }
+    if (argc - arg > 1 || (arg < argc && argv[arg][0] == '-')) {
+        fprintf(stderr, "usage: %s [-f prefix] [-t trace.bin] [-g|-c golden] [script]\n", argv[0]);
+        return 2;
+    }
+#ifndef TRACE_ENABLED
+    if (tracePath) {
+        fprintf(stderr, "-t needs a build with -DTRACE_ENABLED\n");
+        return 2;
+    }
+#endif
+    if (arg < argc && (script = fopen(argv[arg], "r")) == NULL) {
+        perror(argv[arg]);
+        return 2;
+    }
+    if (!loadScript(script)) {
+        return 2;
+    }
+    if (tracePath && (traceFile = fopen(tracePath, "wb")) == NULL) {
+        perror(tracePath);
+        return 2;
+    }
+    if (goldenPath && (goldenFile = fopen(goldenPath, goldenWrite ? "w" : "r")) == NULL) {
+        perror(goldenPath);
+        return 2;
+    }
+    if (goldenWrite) {
+        fprintf(goldenFile, "# frame, FNV-1a of its image; written by tictactoe-host -g, checked by -c\n");
+    }
+
+    gram_reset();
+    hostWaitHook = endFrame;
+    firmwareInit();
+    while (!hostIdle) {
+        firmwareStep();
+    }
+    endFrame();
+    if (goldenFile) {
+        unsigned int frame;
+        unsigned long hash;
+
+        if (!goldenWrite && readGolden(&frame, &hash)) {
+            fprintf(stderr, "frame %u: in the golden file, but the run ended after %u frames\n", frame, frames);
+            goldenMismatches++;
+        }
+        fclose(goldenFile);
+    }
+#ifdef TRACE_ENABLED
+    if (traceFile) {
+        trace_dump(LINK_TRACE << 4, writeTraceFrame);
+        fclose(traceFile);
+    }
+#endif
+
+    printf("simulated time   %10.3f s\n", (double)hostStats.cycles / HOST_MCLK_HZ);
+    printf("cpu awake        %10.3f s (%u permille)\n", (double)hostStats.awakeCycles / HOST_MCLK_HZ, awakePermille());
+    printf("i2c              %10lu bytes in %lu transactions\n", hostStats.i2cBytes, hostStats.i2cTransactions);
+    printf("frames           %10u, %lu bytes each on average, %lu at most\n", frames,
+           frames ? (hostStats.i2cBytes / frames) : 0, frameBytesMax);
+    printf("uart tx          %10lu bytes\n", hostStats.uartTxBytes);
+    printf("link             %10u retransmits, %u failures\n", linkStats.retransmits, linkStats.failures);
+    printf("buttons          %10lu pressed, %lu scan samples\n", hostStats.buttonPresses, hostStats.scanTicks);
+    printf("buzzer           %10lu notes\n", hostStats.notes);
+    printf("soft-timer ticks %10lu\n", hostStats.timerTicks);
+    printf("power samples    %10lu awake, %lu lpm0, %lu lpm3\n",
+           powerStats.awakeSamples, powerStats.lpm0Samples, powerStats.lpm3Samples);
+    printf("events dropped   %10u\n", eventsDropped);
+    if (goldenPath && !goldenWrite) {
+        printf("golden frames    %10u checked, %u mismatched\n", frames, goldenMismatches);
+    }
+    return goldenMismatches ? 1 : 0;
+}
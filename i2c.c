@@ -0,0 +1,179 @@
+/*
+ * i2c.c
+ *
+ * Interrupt driven USCI_B0 master transmitter. i2c_write() copies the
+ * transaction into a queue and returns; the TX interrupt (dispatched from
+ * usci.c) moves the bytes out and chains queued transactions with
+ * repeated STARTs. Callers only block when the queue is full, or in
+ * i2c_flush() when they need the bus to be idle. A renderer can instead
+ * open a transaction with i2c_begin() and hand over its bytes one at a
+ * time with i2c_put(), as it works them out, so it needs no buffer of its
+ * own.
+ */
+
+#include "i2c.h"
+#include "clock.h"
+#include "trace.h"
+#include <msp430.h>
+
+typedef struct {
+    unsigned char address;                                              // 7-bit slave address
+    unsigned char length;                                               // data bytes in the transaction, at most 255
+} I2CTransaction;
+
+static const unsigned char sclDivider[CLOCK_LEVELS] = {                 // UCB0BR0 per clock level
+    CLOCK_DIVIDE(CLOCK_1MHZ, I2C_SCL_HZ),
+    CLOCK_DIVIDE(CLOCK_8MHZ, I2C_SCL_HZ),
+    CLOCK_DIVIDE(CLOCK_16MHZ, I2C_SCL_HZ)
+};
+
+static unsigned char queue[I2C_QUEUE_SIZE];                             // data bytes of all queued transactions
+static volatile unsigned char queueHead = 0;                            // written by i2c_write
+static volatile unsigned char queueTail = 0;                            // written by the TX ISR
+
+static I2CTransaction pending[I2C_MAX_PENDING];                         // transactions not yet started
+static volatile unsigned char pendingHead = 0;
+static volatile unsigned char pendingTail = 0;
+
+static volatile unsigned char remaining = 0;                            // bytes left in the active transaction
+static volatile unsigned char active = 0;                               // a transaction owns the bus
+static volatile unsigned char waiting = 0;                              // main context sleeps until the ISR makes progress
+
+I2CStats i2cStats;                                                      // main context only, counted as transactions are queued
+
+static unsigned char queueFull(void) {
+    return ((queueHead + 1) & (I2C_QUEUE_SIZE - 1)) == queueTail;
+}
+
+static unsigned char pendingFull(void) {
+    return ((pendingHead + 1) & (I2C_MAX_PENDING - 1)) == pendingTail;
+}
+
+static unsigned char busBusy(void) {
+    return active || (pendingHead != pendingTail);
+}
+
+// Load the next queued transaction and generate a (repeated) START for it
+static void startNext(void) {
+    UCB0I2CSA = pending[pendingTail].address;
+    remaining = pending[pendingTail].length;
+    pendingTail = (pendingTail + 1) & (I2C_MAX_PENDING - 1);
+    active = 1;
+    UCB0CTL1 |= UCTR + UCTXSTT;                                         // Transmit mode and START condition
+}
+
+// Advance the transmit state machine by one UCB0TXIFG, returns 1 when a waiter should be woken
+unsigned char i2c_txInterrupt(void) {
+    if (remaining) {
+        if (queueTail == queueHead) {
+            IE2 &= ~UCB0TXIE;                                           // producer fell behind, SCL is stretched until it catches up
+            return 0;
+        }
+        UCB0TXBUF = queue[queueTail];
+        queueTail = (queueTail + 1) & (I2C_QUEUE_SIZE - 1);
+        remaining--;
+    } else if (pendingHead != pendingTail) {
+        startNext();                                                    // chain without releasing the bus
+    } else {
+        UCB0CTL1 |= UCTXSTP;                                            // last byte is shifting out, send STOP
+        IE2 &= ~UCB0TXIE;
+        active = 0;
+    }
+
+    if (waiting) {
+        waiting = 0;
+        return 1;
+    }
+    return 0;
+}
+
+// Start the bus if it is idle, or resume it after an underflow
+static void kick(void) {
+    unsigned short state = __get_interrupt_state();
+    __disable_interrupt();
+
+    if (!active && (pendingHead != pendingTail)) {
+        while (UCB0CTL1 & UCTXSTP);                                     // previous STOP still on the bus
+        startNext();
+    }
+    if (active) {
+        IE2 |= UCB0TXIE;
+    }
+
+    __set_interrupt_state(state);
+}
+
+// Block until blocked() returns 0, sleeping if interrupts are on and polling the hardware otherwise
+static void waitWhile(unsigned char (*blocked)(void)) {
+    if (__get_SR_register() & GIE) {
+        __disable_interrupt();
+        while (blocked()) {
+            waiting = 1;
+            __bis_SR_register(LPM0_bits + GIE);                         // TX ISR wakes us after making progress
+            __disable_interrupt();
+        }
+        __enable_interrupt();
+    } else {
+        while (blocked()) {                                             // called during init or from another ISR
+            if (active && (IFG2 & UCB0TXIFG)) {
+                i2c_txInterrupt();
+            }
+        }
+    }
+}
+
+// Initialize I2C Communication
+void initI2C(void) {
+    P1SEL |= BIT6 + BIT7;   // Assign I2C pins to USCI_B0 (SCL, SDA)
+    P1SEL2 |= BIT6 + BIT7;
+    UCB0CTL1 |= UCSWRST;    // Enable software reset
+    UCB0CTL0 = UCMST + UCMODE_3 + UCSYNC;  // I2C Master mode
+    UCB0CTL1 |= UCSSEL_2;   // Use SMCLK
+    UCB0BR0 = sclDivider[clock_level()];  // fSCL = SMCLK/divider = ~100kHz
+    UCB0BR1 = 0;
+    UCB0CTL1 &= ~UCSWRST;   // Clear reset
+}
+
+// Keep SCL at I2C_SCL_HZ after SMCLK has changed; the caller has flushed the queue
+void i2c_applyClock(void) {
+    UCB0CTL1 |= UCSWRST;
+    UCB0BR0 = sclDivider[clock_level()];
+    UCB0CTL1 &= ~UCSWRST;
+}
+
+// Queue a write transaction, returns as soon as every byte is in the queue
+void i2c_write(unsigned int slave_address, const unsigned char *data, unsigned int length) {
+    TRACE_BEGIN(TRACE_I2C_WRITE);
+    i2c_begin(slave_address, length);
+    while (length--) {
+        i2c_put(*data++);
+    }
+    TRACE_END(TRACE_I2C_WRITE);
+}
+
+// Queue a write transaction whose length (at most 255) data bytes follow through i2c_put(); the bus may start on it
+// straight away. Nothing else may be queued until the last of them is in.
+void i2c_begin(unsigned int slave_address, unsigned int length) {
+    i2cStats.transactions++;
+    i2cStats.bytes += length + 1;                                       // address byte first
+    waitWhile(pendingFull);
+
+    pending[pendingHead].address = slave_address;
+    pending[pendingHead].length = length;
+    pendingHead = (pendingHead + 1) & (I2C_MAX_PENDING - 1);
+    kick();
+}
+
+// Queue the next byte of the open transaction, blocking while the queue is full
+void i2c_put(unsigned char byte) {
+    waitWhile(queueFull);
+    queue[queueHead] = byte;
+    queueHead = (queueHead + 1) & (I2C_QUEUE_SIZE - 1);
+    kick();
+}
+
+// Fence: wait until every queued transaction has been sent
+void i2c_flush(void) {
+    waitWhile(busBusy);
+    while (UCB0CTL1 & UCTXSTP);                                         // Wait for STOP condition to complete
+}
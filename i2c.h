@@ -0,0 +1,33 @@
+/*
+ * i2c.h
+ */
+
+#ifndef I2C_H_
+#define I2C_H_
+
+/* ====================================================================
+ * I2C Transmit Queue Settings
+ * ==================================================================== */
+#define I2C_QUEUE_SIZE      32                                          // queued data bytes, must be a power of two
+#define I2C_MAX_PENDING     4                                           // queued transactions, must be a power of two
+#define I2C_SCL_HZ          100000UL                                    // standard mode
+
+typedef struct {
+    unsigned long bytes;                                                // bytes on the bus, address bytes included
+    unsigned long transactions;
+} I2CStats;
+
+extern I2CStats i2cStats;
+
+/* ====================================================================
+ * I2C Prototype Definitions
+ * ==================================================================== */
+void initI2C(void);
+void i2c_write(unsigned int, const unsigned char *, unsigned int);
+void i2c_begin(unsigned int, unsigned int);
+void i2c_put(unsigned char);
+void i2c_flush(void);
+void i2c_applyClock(void);
+unsigned char i2c_txInterrupt(void);
+
+#endif /* I2C_H_ */
@@ -0,0 +1,73 @@
+/*
+ * input.c
+ *
+ * Debounce for the two buttons, sampled on the HAL scan tick. The press
+ * is reported as soon as INPUT_PRESS_SAMPLES samples in a row find the
+ * button down, two scan ticks after the edge, so a single-sample glitch
+ * is rejected without making every press wait out the bounce. From then
+ * on an integrator decides: each sample that finds the button down adds
+ * one, each that finds it up takes one away, within 0 and
+ * INPUT_INTEGRATOR. It starts full at the press, and the release (which
+ * re-arms the press) is only taken once it has drained to 0. Bounce in
+ * between just moves it. While a button stays down its hold count gives
+ * one INPUT_LONG and then INPUT_REPEAT.
+ */
+
+#include "input.h"
+#include "events.h"
+
+#define LONG_TICKS      (INPUT_LONG_MS / HAL_SCAN_MS)
+#define REPEAT_TICKS    (INPUT_REPEAT_MS / HAL_SCAN_MS)
+
+typedef struct {
+    unsigned char bit;                                                  // HAL_BUTTON_*
+    unsigned char integrator;
+    unsigned char down;                                                 // press reported, release not yet
+    unsigned char streak;                                               // down samples in a row while released
+    unsigned int held;                                                  // down samples since the press
+} Button;
+
+static Button buttons[2] = {{HAL_BUTTON_1, 0, 0, 0, 0}, {HAL_BUTTON_2, 0, 0, 0, 0}};  // scan ISR only
+
+// Scan ISR side: one sample, with the bits of the buttons held down; returns 1 if an event was queued
+unsigned char input_scan(unsigned char levels) {
+    unsigned char queued = 0;
+    unsigned char i;
+
+    for (i = 0; i < 2; i++) {
+        Button *button = &buttons[i];
+        unsigned char isDown = (levels & button->bit) != 0;
+
+        if (isDown && button->integrator < INPUT_INTEGRATOR) {
+            button->integrator++;
+        } else if (!isDown && button->integrator > 0) {
+            button->integrator--;
+        }
+
+        if (!button->down) {
+            button->streak = isDown ? button->streak + 1 : 0;
+            if (button->streak == INPUT_PRESS_SAMPLES) {
+                button->down = 1;
+                button->held = 0;
+                button->streak = 0;
+                button->integrator = INPUT_INTEGRATOR;                  // the release has to drain it all
+                queued |= pushEvent(EVENT_BUTTON, button->bit | INPUT_PRESS);
+            }
+        } else if (button->integrator == 0) {
+            button->down = 0;
+            queued |= pushEvent(EVENT_BUTTON, button->bit | INPUT_RELEASE);
+        } else if (isDown && ++button->held >= LONG_TICKS) {
+            if (button->held == LONG_TICKS) {
+                queued |= pushEvent(EVENT_BUTTON, button->bit | INPUT_LONG);
+            } else if ((button->held - LONG_TICKS) % REPEAT_TICKS == 0) {
+                queued |= pushEvent(EVENT_BUTTON, button->bit | INPUT_REPEAT);
+            }
+        }
+    }
+    return queued;
+} // end input_scan
+
+// Both buttons released and settled, the scan can stop until the next edge
+unsigned char input_idle(void) {
+    return !buttons[0].down && !buttons[1].down && buttons[0].integrator == 0 && buttons[1].integrator == 0;
+} // end input_idle
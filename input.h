@@ -0,0 +1,36 @@
+/*
+ * input.h
+ */
+
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include "hal.h"
+
+/* ====================================================================
+ * Input Events: the EVENT_BUTTON argument is the HAL_BUTTON_* bit of
+ * the button ORed with one of these
+ * ==================================================================== */
+#define INPUT_PRESS         0x10
+#define INPUT_RELEASE       0x20
+#define INPUT_LONG          0x40                                        // held for INPUT_LONG_MS, sent once per press
+#define INPUT_REPEAT        0x80                                        // every INPUT_REPEAT_MS after INPUT_LONG while still held
+
+#define INPUT_BUTTON(arg)   ((arg) & (HAL_BUTTON_1 | HAL_BUTTON_2))
+#define INPUT_KIND(arg)     ((arg) & 0xF0)
+
+/* ====================================================================
+ * Input Settings
+ * ==================================================================== */
+#define INPUT_PRESS_SAMPLES 2                                           // down samples in a row that report a press
+#define INPUT_INTEGRATOR    4                                           // net up samples after a press that release it
+#define INPUT_LONG_MS       600
+#define INPUT_REPEAT_MS     150
+
+/* ====================================================================
+ * Input Prototype Definitions
+ * ==================================================================== */
+unsigned char input_scan(unsigned char);
+unsigned char input_idle(void);
+
+#endif /* INPUT_H_ */
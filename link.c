@@ -0,0 +1,214 @@
+/*
+ * link.c
+ *
+ * Reliable message layer between the two gamepads, on top of the framed
+ * UART. Each message is a UART frame whose first byte holds the type and
+ * a 4-bit sequence number. Messages go out one at a time and are sent
+ * again until the other board answers with a LINK_ACK carrying the same
+ * sequence number; the receiver acknowledges every frame but delivers a
+ * repeated sequence number only once.
+ *
+ * LINK_BAUD moves both boards to a faster rate: the receiver switches
+ * after its ACK has left the wire, the sender when the ACK arrives. A
+ * board that cannot talk at the new rate falls back to 9600.
+ */
+
+#include "link.h"
+#include "power.h"
+#include "trace.h"
+
+LinkStats linkStats;
+
+static LinkMessage queue[LINK_QUEUE_SIZE];                              // main loop only, no ISR access
+static unsigned char head = 0;
+static unsigned char tail = 0;                                          // message in flight when outstanding
+static unsigned char outstanding = 0;
+static unsigned char txSeq = 0;
+static unsigned char rxSeq = 0xFF;                                      // last sequence number delivered
+static unsigned char timeout = 0;
+static unsigned char retries = 0;
+static unsigned char confirmTicks = 0;                                  // counting down after a baud change
+
+static void sendHead(void) {
+    unsigned char payload[UART_MAX_FRAME];
+    unsigned char i;
+
+    payload[0] = (queue[tail].type << 4) | txSeq;
+    for (i = 0; i < queue[tail].length; i++) {
+        payload[i + 1] = queue[tail].data[i];
+    }
+    uart_sendFrame(payload, queue[tail].length + 1);
+
+    outstanding = 1;
+    timeout = LINK_TIMEOUT_TICKS;
+    requestTicks(TICK_LINK);
+}
+
+// Switch rate and expect to hear a good frame before LINK_CONFIRM_TICKS run out
+static void changeBaud(unsigned char baud) {
+    uart_setBaud(baud);
+    confirmTicks = (baud == UART_BAUD_9600) ? 0 : LINK_CONFIRM_TICKS;
+    if (confirmTicks) {
+        requestTicks(TICK_LINK);
+    }
+}
+
+// Retire the message in flight and start the next one
+static void finishHead(unsigned char acknowledged) {
+    unsigned char type = queue[tail].type;
+    unsigned char arg = queue[tail].data[0];
+
+    tail = (tail + 1) & (LINK_QUEUE_SIZE - 1);
+    txSeq = (txSeq + 1) & 0x0F;
+    outstanding = 0;
+    retries = 0;
+
+    if (acknowledged && type == LINK_BAUD && arg != uart_getBaud()) {
+        changeBaud(arg);
+        link_send(LINK_BAUD, arg);                                      // confirm at the new rate
+    }
+
+    if (!outstanding && tail != head) {
+        sendHead();
+    }
+    if (!outstanding && !confirmTicks) {
+        releaseTicks(TICK_LINK);
+    }
+}
+
+static void acknowledge(unsigned char seq) {
+    unsigned char payload = (LINK_ACK << 4) | seq;
+    uart_sendFrame(&payload, 1);
+}
+
+// Queue a message for reliable delivery
+void link_sendData(unsigned char type, const unsigned char *data, unsigned char length) {
+    unsigned char next = (head + 1) & (LINK_QUEUE_SIZE - 1);
+    unsigned char i;
+
+    TRACE_BEGIN(TRACE_LINK_SEND);
+    if (next == tail || length > LINK_MAX_DATA) {
+        linkStats.failures++;                                           // other board has stopped answering
+        TRACE_END(TRACE_LINK_SEND);
+        return;
+    }
+
+    queue[head].type = type;
+    queue[head].length = length;
+    for (i = 0; i < length; i++) {
+        queue[head].data[i] = data[i];
+    }
+    head = next;
+
+    if (!outstanding) {
+        sendHead();
+    }
+    TRACE_END(TRACE_LINK_SEND);
+}
+
+// Handle received frames, returns 1 with the next message meant for the game
+unsigned char link_poll(LinkMessage *message) {
+    unsigned char frame[UART_MAX_FRAME];
+    unsigned char length, i;
+
+    while ((length = uart_readFrame(frame, sizeof(frame))) != 0) {
+        unsigned char type = frame[0] >> 4;
+        unsigned char seq = frame[0] & 0x0F;
+
+        confirmTicks = 0;                                               // the current rate works
+
+        if (type == LINK_ACK) {
+            if (outstanding && seq == txSeq) {
+                finishHead(1);
+            }
+            continue;
+        }
+
+#ifdef TRACE_ENABLED
+        if (type == LINK_TRACE) {
+            trace_dump(LINK_TRACE << 4, uart_sendFrame);                // raw frames, a PC asked and does not acknowledge
+            continue;
+        }
+#endif
+
+        acknowledge(seq);
+        if (seq == rxSeq) {
+            linkStats.duplicates++;                                     // our ACK was lost, do not deliver twice
+            continue;
+        }
+        rxSeq = seq;
+
+        if (type == LINK_BAUD) {
+            if (length > 1 && frame[1] != uart_getBaud() && frame[1] <= UART_BAUD_115200) {
+                changeBaud(frame[1]);                                   // flushes the ACK out at the old rate first
+            }
+            continue;
+        }
+
+        message->type = type;
+        message->length = length - 1;
+        for (i = 0; i < message->length; i++) {
+            message->data[i] = frame[i + 1];
+        }
+        return 1;
+    }
+
+    if (!outstanding && !confirmTicks) {
+        releaseTicks(TICK_LINK);
+    }
+    return 0;
+}
+
+// Retransmit timer, run on every EVENT_TICK, returns the type of a message given up on
+unsigned char link_tick(void) {
+    unsigned char lost = 0;
+
+    if (confirmTicks && --confirmTicks == 0) {
+        linkStats.failures++;                                           // nothing decodable at the new rate
+        uart_setBaud(UART_BAUD_9600);
+    }
+
+    if (outstanding && --timeout == 0) {
+        if (retries < LINK_MAX_RETRIES) {
+            retries++;
+            linkStats.retransmits++;
+            sendHead();
+        } else if (uart_getBaud() != UART_BAUD_9600) {
+            linkStats.failures++;                                       // try once more at the safe rate
+            uart_setBaud(UART_BAUD_9600);
+            confirmTicks = 0;
+            retries = 0;
+            sendHead();
+        } else {
+            linkStats.failures++;
+            lost = queue[tail].type;
+            finishHead(0);
+        }
+    }
+
+    if (!outstanding && !confirmTicks) {
+        releaseTicks(TICK_LINK);
+    }
+    return lost;
+}
+
+// Drop everything still queued, used once there is no other board to talk to
+void link_reset(void) {
+    head = tail = 0;
+    outstanding = 0;
+    retries = 0;
+    if (!confirmTicks) {
+        releaseTicks(TICK_LINK);
+    }
+}
+
+// Queue a message with a single argument byte
+void link_send(unsigned char type, unsigned char arg) {
+    link_sendData(type, &arg, 1);
+}
+
+void link_proposeBaud(unsigned char baud) {
+    if (baud != uart_getBaud()) {
+        link_send(LINK_BAUD, baud);
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * link.h
+ */
+
+#ifndef LINK_H_
+#define LINK_H_
+
+#include "uart.h"
+#include "game.h"
+
+/* ====================================================================
+ * Link Message Types (high nibble of the first payload byte, the low
+ * nibble carries the sequence number)
+ * ==================================================================== */
+#define LINK_SELECT         1                                           // arg: marker the sender plays
+#define LINK_MOVE           2                                           // arg: packed move, then the hash of the board after it
+#define LINK_WIN            3                                           // arg: winning marker
+#define LINK_DRAW           4
+#define LINK_RESET          5
+#define LINK_BAUD           6                                           // arg: UART_BAUD_* to switch to once acknowledged
+#define LINK_ACK            7                                           // sequence number of the frame received, no arg
+#define LINK_SYNC_REQ       8                                           // data: sender's packed board, its hash did not match
+#define LINK_SYNC           9                                           // data: packed moves for the cells the other board lacks
+#define LINK_BOARD          10                                          // data: the whole packed board, merged like LINK_SYNC
+#define LINK_TRACE          11                                          // from a PC: dump the trace ring (TRACE_ENABLED builds only)
+
+/* ====================================================================
+ * Move Packing: bit 7 set for 'O', bits 0-5 the cell index
+ * (row * GAME_SIZE + column)
+ * ==================================================================== */
+#define LINK_MOVE_PACK(x, y, marker)    ((unsigned char)((((marker) == 'O') ? 0x80 : 0x00) | ((y) * GAME_SIZE + (x))))
+#define LINK_MOVE_X(move)               (((move) & 0x3F) % GAME_SIZE)
+#define LINK_MOVE_Y(move)               (((move) & 0x3F) / GAME_SIZE)
+#define LINK_MOVE_MARKER(move)          (((move) & 0x80) ? 'O' : 'X')
+
+/* ====================================================================
+ * Link Settings
+ * ==================================================================== */
+#define LINK_QUEUE_SIZE     4                                           // messages awaiting delivery, must be a power of two
+#define LINK_MAX_DATA       (UART_MAX_FRAME - 1)                        // bytes after the type/sequence byte
+#define LINK_TIMEOUT_TICKS  3                                           // ticks (~40 ms each) before a retransmit
+#define LINK_MAX_RETRIES    5                                           // retransmits before giving up on a message
+#define LINK_CONFIRM_TICKS  24                                          // ticks a new baud rate has to prove itself
+
+#if GAME_PACKED_SIZE > LINK_MAX_DATA
+#error "a packed board must fit in one link message"
+#endif
+
+#ifndef LINK_FAST_BAUD
+#define LINK_FAST_BAUD      UART_BAUD_115200                            // rate proposed once a game starts
+#endif
+
+typedef struct {
+    unsigned char type;
+    unsigned char length;                                               // bytes used in data
+    unsigned char data[LINK_MAX_DATA];
+} LinkMessage;
+
+typedef struct {
+    unsigned int retransmits;                                           // frames sent again after a timeout
+    unsigned int failures;                                              // messages given up on, or baud fallbacks
+    unsigned int duplicates;                                            // retransmitted frames already delivered
+} LinkStats;
+
+extern LinkStats linkStats;
+
+/* ====================================================================
+ * Link Prototype Definitions
+ * ==================================================================== */
+void link_send(unsigned char, unsigned char);
+void link_sendData(unsigned char, const unsigned char *, unsigned char);
+unsigned char link_poll(LinkMessage *);
+unsigned char link_tick(void);
+void link_reset(void);
+void link_proposeBaud(unsigned char);
+
+#endif /* LINK_H_ */
@@ -3,167 +3,178 @@
  * Neha R Rao
  */
 
-#include <msp430.h>
+#include "hal.h"      // Clocks, buttons, LED and the soft-timer tick
+#include "input.h"    // Debounced press, release, long-press and repeat events
 #include "ssd1306.h"  // Include your SSD1306 OLED library
+#include "i2c.h"      // Queued, interrupt driven I2C transmit
+#include "tone.h"     // Background buzzer tones
+#include "power.h"    // Low power sleep and awake time accounting
+#include "events.h"   // ISR to main loop event queue
+#include "link.h"     // Reliable framed link to the other board
+#include "game.h"     // Bitboard rules
+#include "ai.h"       // Built-in opponent when no other board answers
+#include "sprites.h"  // Cell-sized marker bitmaps
+#include "timer.h"    // Scheduled continuations instead of blocking delays
+#include "trace.h"    // Timing events, compiled out unless TRACE_ENABLED
+#include "clock.h"    // DCO levels for work and for sleep
+#include "ram.h"      // Static RAM budget, checked at compile time
 
 // Function prototypes
-void initI2C();
-void i2c_write(unsigned int slave_address, unsigned char *data, unsigned int length);
-void initButtons();
-void initBuzzer();
-void playBuzzer(unsigned int frequency, unsigned int duration);
+void firmwareInit();
+void firmwareStep();
 void playEventSound(char event);
 void displayStartMessage();
 void displayPlayerSelection();
+void startSelection();
+void displayLevelSelection();
+void renderGridPage(unsigned int page, unsigned int firstX, unsigned int width);
 void drawGrid();
-void drawMarker(unsigned int x, unsigned int y, char marker);
+void drawCell(unsigned int x, unsigned int y);
+unsigned int spriteTop(unsigned int y);
+unsigned char spriteColumn(char marker, unsigned int cell, unsigned int i, int shift);
+char cellView(unsigned int cell);
+void refreshCells();
 void moveMarker();
 void placeMarker();
-void checkWinCondition();
-void resetGame();
-void initDebounceTimer();
-void initUART();
-void transmitData(const char *data);
-void handleReceivedData();
-void startDebounceTimer();
+void playComputerMove();
+unsigned char checkWinCondition(unsigned char cell);
+void showResult(unsigned char result, char player);
+void flashStep();
+void showBanner();
+void fadeStep();
+void resetGame(unsigned char notifyOther);
+void handleReceivedData(const LinkMessage *message);
+void handleButton(unsigned char input);
+void mergeBoard(const unsigned char *otherBoard);
+
+// Grid layout, derived from the board size
+#define CELL_WIDTH   (SSD1306_LCDWIDTH / GAME_SIZE)   // 42 pixels on 3x3
+#define CELL_HEIGHT  (SSD1306_LCDHEIGHT / GAME_SIZE)  // 21 pixels on 3x3
+#define SPRITE_LEFT(x) ((x) * CELL_WIDTH + (CELL_WIDTH - SPRITE_WIDTH) / 2)   // Marker centred in its cell
+
+// End-of-game animation, RESULT_MS in all
+#define RESULT_MS    5000
+#define FLASH_COUNT  6    // Invert toggles while the winning line is shown, even so the panel ends up normal
+#define FLASH_MS     250
+#define FADE_STEPS   8    // Contrast steps down to 0
+#define FADE_MS      500
+#define STARTUP_MS   500   // OLED settling time before the first screen
+#define RESET_MS     1000  // Blank pause between the result and the selection screen
 
 // Global variables
-unsigned int markerX = 0;  // Marker column position (0 to 2)
-unsigned int markerY = 0;  // Marker row position (0 to 2)
-char grid[3][3] = {{' ', ' ', ' '}, {' ', ' ', ' '}, {' ', ' ', ' '}};  // Logical grid for X and O
+unsigned int markerX = 0;  // Marker column position (0 to GAME_SIZE - 1)
+unsigned int markerY = 0;  // Marker row position (0 to GAME_SIZE - 1)
 char currentPlayer = 'X';  // Current player ('X' or 'O')
 unsigned int gameOver = 0;  // Game state flag
-volatile unsigned int gamePhase = 0;  // 0: Player Selection, 1: Gameplay
+volatile unsigned int gamePhase = 4;  // 0: Player Selection, 1: Gameplay Setup, 2: Gameplay, 3: Level Selection, 4: Between screens
+unsigned char singlePlayer = 0;  // 1: Playing against the built-in opponent
+unsigned char aiLevel = AI_MEDIUM;  // Difficulty of the built-in opponent
+GameMask highlightCells = 0;  // Cells drawn inverted, the winning line while it flashes
+unsigned char resultOutcome;  // GAME_WIN or GAME_DRAW while the result animation runs
+char resultWinner;  // Marker that won
+unsigned char resultStep;  // Flashes or fade steps done so far
+char shownCells[GAME_CELLS];  // What each cell shows on the OLED: ' ', 'X', 'O', or 'x'/'o' previewed under the cursor
 volatile unsigned char resetPending = 0;  // 0: No reset, 1: Reset is pending
 volatile unsigned char waitingForReset = 0; // 0: Normal state, 1: Waiting for Reset
 
-// UART-specific variables
-volatile char rxBuffer[10] = {0};
-volatile unsigned int rxIndex = 0;
-volatile char txBuffer[10] = {0};
-volatile unsigned int txIndex = 0;
-volatile unsigned char dataReceived = 0;
-volatile unsigned char resetHandled = 0;  // 0: Reset not handled, 1: Reset handled
-
+#if !defined(HOST_BUILD) && !defined(BENCH_BUILD)  // The host build and the benchmark supply their own main()
 int main(void) {
-    WDTCTL = WDTPW | WDTHOLD;  // Stop watchdog timer
-    BCSCTL1 = CALBC1_1MHZ;
-    DCOCTL = CALDCO_1MHZ;
+    firmwareInit();
+
+    while (1) {
+        firmwareStep();
+    }
+}
+#endif
 
+// Bring up the hardware and show the selection screen
+void firmwareInit() {
+    hal_initClocks();          // Stop watchdog, DCO at CLOCK_IDLE
     initI2C();                 // Initialize I2C communication
-    initButtons();             // Initialize buttons
+    hal_initButtons();         // Initialize buttons and their debounce timer
     initBuzzer();              // Initialize buzzer
-    initLED();                 // Initialize LED
-    initDebounceTimer();       // Initialize debounce timer
+    hal_initLED();             // Initialize LED
     initUART();                // Initialize UART communication
+    initPowerStats();          // Start sampling awake/asleep time
     ssd1306_init();            // Initialize OLED display
+    i2c_flush();               // Interrupts are still off, push the init sequence out now
 
-    __delay_cycles(500000);    // Short delay to stabilize OLED
+    timer_start(startSelection, STARTUP_MS, 0);  // Let the OLED settle, then allow players to choose 'X' or 'O'
 
-    displayPlayerSelection();  // Allow players to choose 'X' or 'O'
+    hal_enableInterrupts();    // Enable global interrupts
+}
 
-    __bis_SR_register(GIE);    // Enable global interrupts
+// One pass of the main loop: handle pending work, then sleep until an ISR has more
+void firmwareStep() {
+    clock_set(CLOCK_BOOST);  // The opponent's search and rendering finish sooner; bus transfers keep their rates
 
-    while (1) {
-        if (gameOver && !resetHandled) {  // Only reset the game once
-            resetGame();
-            resetHandled = 1;  // Mark reset as handled
-        }
-
-        if (gamePhase == 1) {  // Gameplay Setup Phase
-            drawGrid();  // Transition to gameplay by drawing the grid
-            gamePhase = 2;  // Indicate that the game is now in progress
-        }
+    if (gamePhase == 1) {  // Gameplay Setup Phase
+        timer_stop(startSelection);  // The other board chose while this one was between screens
+        drawGrid();  // Transition to gameplay by drawing the grid
+        gamePhase = 2;  // Indicate that the game is now in progress
+    }
 
-        if (dataReceived) {
-            handleReceivedData();  // Handle received UART data
-            dataReceived = 0;
+    Event event;
+    while (popEvent(&event)) {  // Dispatch everything the ISRs queued
+        if (event.type == EVENT_BUTTON) {
+            handleButton(event.arg);
+        } else if (event.type == EVENT_FRAME) {
+            LinkMessage message;
+            while (link_poll(&message)) {
+                TRACE_BEGIN(TRACE_HANDLE_RX);
+                handleReceivedData(&message);  // Handle every message waiting in the RX ring
+                TRACE_END(TRACE_HANDLE_RX);
+            }
+        } else if (event.type == EVENT_TICK) {
+            if (link_tick() == LINK_SELECT && gamePhase != 0) {  // Retransmit unacknowledged messages
+                link_reset();  // Nobody answered the marker choice, offer a game against the pad
+                gamePhase = 3;
+                displayLevelSelection();
+            }
+        } else if (event.type == EVENT_TIMER) {
+            timer_run();  // Continuations that have fallen due
         }
     }
-}
 
-// Initialize I2C Communication
-void initI2C() {
-    P1SEL |= BIT6 + BIT7;   // Assign I2C pins to USCI_B0 (SCL, SDA)
-    P1SEL2 |= BIT6 + BIT7;
-    UCB0CTL1 |= UCSWRST;    // Enable software reset
-    UCB0CTL0 = UCMST + UCMODE_3 + UCSYNC;  // I2C Master mode
-    UCB0CTL1 |= UCSSEL_2;   // Use SMCLK
-    UCB0BR0 = 10;           // fSCL = SMCLK/10 = ~100kHz
-    UCB0BR1 = 0;
-    UCB0CTL1 &= ~UCSWRST;   // Clear reset
-}
-
-// I2C Write Function
-void i2c_write(unsigned int slave_address, unsigned char *data, unsigned int length) {
-    UCB0I2CSA = slave_address;  // Set slave address
-    UCB0CTL1 |= UCTR + UCTXSTT;  // Transmit mode and START condition
-
-    while (length--) {
-        while (!(IFG2 & UCB0TXIFG));  // Wait for TX buffer to be ready
-        UCB0TXBUF = *data++;          // Load data into TX buffer
+    if (!eventPending()) {
+        clock_set(CLOCK_IDLE);  // LPM0 keeps the DCO running, a slower one draws less; switched with interrupts on, it may drain the buses
     }
 
-    while (!(IFG2 & UCB0TXIFG));  // Wait for the last byte to be transmitted
-    UCB0CTL1 |= UCTXSTP;          // Send STOP condition
-    while (UCB0CTL1 & UCTXSTP);   // Wait for STOP condition to complete
-}
-
-// Initialize Buttons
-void initButtons() {
-    P1DIR &= ~(BIT0 + BIT3);  // Set P1.2 and P1.3 as inputs
-    P1REN |= BIT0 + BIT3;     // Enable pull-up/down resistors
-    P1OUT |= BIT0 + BIT3;     // Configure as pull-ups
-    P1IES |= BIT0 + BIT3;     // Trigger on high-to-low transition
-    P1IFG &= ~(BIT0 + BIT3);  // Clear interrupt flags
-    P1IE |= BIT0 + BIT3;      // Enable interrupts for P1.2 and P1.3
-}
-
-// Initialize Buzzer
-void initBuzzer() {
-    P1DIR |= BIT4;  // Set P1.4 as output for buzzer
-    P1OUT &= ~BIT4; // Turn off buzzer initially
-}
-
-
-// Play Buzzer
-void playBuzzer(unsigned int frequency, unsigned int duration) {
-    unsigned int delay = 1000000 / frequency / 2;  // Calculate delay for given frequency
-    unsigned int cycles = (frequency * duration) / 1000;  // Calculate total cycles for duration in ms
-
-    while (cycles--) {
-        P1OUT |= BIT4;          // Turn on buzzer
-        unsigned int i = 0;
-        for (i = 0; i < delay; i++) {
-            __no_operation();   // Software delay loop
-        }
-        P1OUT &= ~BIT4;         // Turn off buzzer
-        for ( i = 0; i < delay; i++) {
-            __no_operation();   // Software delay loop
-        }
+    // Sleep until an ISR has something for the loop; check the flags with interrupts off so no wakeup is lost
+    hal_disableInterrupts();
+    if (gamePhase != 1 && !eventPending()) {
+        enterLowPower(buzzerBusy() || hal_debounceActive() || timer_active());  // Timer_A needs SMCLK, so only LPM0 while it runs
     }
+    hal_enableInterrupts();
 }
 
+// Event sounds, played in the background by the tone engine
+const Note navigateSound[] = {{400, 200}};
+const Note placeSound[] = {{1000, 300}};
+const Note remotePlaceSound[] = {{1000, 200}};
+const Note winSound[] = {{800, 200}, {TONE_REST, 200}, {1000, 200}, {TONE_REST, 200}, {1200, 300}};  // Rising tones
+const Note loseSound[] = {{800, 200}, {TONE_REST, 200}, {600, 200}, {TONE_REST, 200}, {400, 300}};  // Falling tones
+const Note drawSound[] = {{700, 200}, {TONE_REST, 200}, {700, 200}};  // Flat tone, repeated
+
 void playEventSound(char event) {
     switch (event) {
+        case 'N':  // Navigation sound; held-button repeats come faster than the note, so a waiting one is not queued twice
+            playNote(navigateSound);
+            break;
+        case 'P':  // Placement sound
+            playMelody(placeSound, sizeof(placeSound) / sizeof(Note));
+            break;
+        case 'R':  // Opponent placement sound
+            playMelody(remotePlaceSound, sizeof(remotePlaceSound) / sizeof(Note));
+            break;
         case 'W':  // Win sound
-            playBuzzer(800, 200);  // Higher tone
-            __delay_cycles(200000);  // Short pause
-            playBuzzer(1000, 200);  // Even higher tone
-            __delay_cycles(200000);
-            playBuzzer(1200, 300);  // Final tone
+            playMelody(winSound, sizeof(winSound) / sizeof(Note));
             break;
         case 'L':  // Lose sound
-            playBuzzer(800, 200);  // Higher tone
-            __delay_cycles(200000);
-            playBuzzer(600, 200);  // Lower tone
-            __delay_cycles(200000);
-            playBuzzer(400, 300);  // Final low tone
+            playMelody(loseSound, sizeof(loseSound) / sizeof(Note));
             break;
         case 'D':  // Draw sound
-            playBuzzer(700, 200);  // Flat tone
-            __delay_cycles(200000);
-            playBuzzer(700, 200);  // Repeat the same tone
+            playMelody(drawSound, sizeof(drawSound) / sizeof(Note));
             break;
         default:  // No action for unknown event
             break;
@@ -181,368 +192,487 @@ void displayPlayerSelection() {
     ssd1306_printText(0, 5, "Press Btn 2 for O");
 }
 
-// Draw the Tic Tac Toe Grid
-void drawGrid() {
-    ssd1306_clearDisplay();  // Clear the OLED display
-
-    // Declare variables outside the loop for compatibility
-    int x, y, i, j;
-
-    // Draw horizontal lines
-    for (y = 21; y <= 43; y += 22) {
-        for (x = 0; x < 128; x++) {
-            ssd1306_setPosition(x, y / 8);  // Set pixel position
-            buffer[0] = 0x40;
-            buffer[1] = 0xFF;  // Full line
-            i2c_write(SSD1306_I2C_ADDRESS, buffer, 2);
+// Continuation: the wait before the selection screen is over
+void startSelection() {
+    gamePhase = 0;
+    displayPlayerSelection();
+}
+
+// Level Selection Phase, shown when no other board is connected
+void displayLevelSelection() {
+    static char *const levelNames[AI_LEVELS] = {"Level: Easy  ", "Level: Medium", "Level: Hard  "};
+
+    ssd1306_clearDisplay();
+    ssd1306_printText(0, 0, "No opponent found");
+    ssd1306_printText(0, 2, levelNames[aiLevel]);
+    ssd1306_printText(0, 4, "Btn 1: change level");
+    ssd1306_printText(0, 5, "Btn 2: start");
+}
+
+// Stream columns firstX to firstX + width - 1 of one 8-pixel display page of the grid (lines and markers) into the
+// I2C transaction the caller has opened, one column at a time
+void renderGridPage(unsigned int page, unsigned int firstX, unsigned int width) {
+    int shift[GAME_SIZE];  // Rows each grid row's sprites start below the top of this page
+    char marker[GAME_SIZE];  // What the cells of the current grid column show, per grid row
+    unsigned int x, i;
+    unsigned int column = 0, cellX = 0;  // Grid column of x and its first pixel column
+    unsigned char fill = 0x00;
+
+    // Horizontal lines between the rows run across the whole page
+    for (i = 1; i < GAME_SIZE; i++) {
+        if (i * CELL_HEIGHT / 8 == page) {
+            fill |= 1 << (i * CELL_HEIGHT % 8);
         }
     }
 
-    // Draw vertical lines
-    for (x = 42; x <= 85; x += 43) {
-        for (y = 0; y < 64; y++) {
-            ssd1306_setPosition(x, y / 8);
-            buffer[0] = 0x40;
-            buffer[1] = 0xFF;  // Full line
-            i2c_write(SSD1306_I2C_ADDRESS, buffer, 2);
-        }
+    for (i = 0; i < GAME_SIZE; i++) {
+        shift[i] = spriteTop(i) - (int)(page * 8);
+        marker[i] = ' ';
+    }
+    while (column < GAME_SIZE && cellX + CELL_WIDTH <= firstX) {
+        column++;
+        cellX += CELL_WIDTH;
     }
 
-    // Redraw any existing markers
-    for (i = 0; i < 3; i++) {
-        for (j = 0; j < 3; j++) {
-            if (grid[i][j] != ' ') {
-                drawMarker(j, i, grid[i][j]);
+    for (x = firstX; x < firstX + width; x++) {
+        unsigned int spriteLeft = cellX + (CELL_WIDTH - SPRITE_WIDTH) / 2;
+        unsigned char bits;
+
+        if (column < GAME_SIZE && x == cellX + CELL_WIDTH) {
+            column++;
+            cellX += CELL_WIDTH;
+            spriteLeft = cellX + (CELL_WIDTH - SPRITE_WIDTH) / 2;
+        }
+
+        // Vertical lines between the columns cross every page
+        bits = (x == cellX && column > 0 && column < GAME_SIZE) ? 0xFF : fill;
+
+        // Markers overlapping this page, looked up once per cell as its sprite starts
+        if (column < GAME_SIZE && x >= spriteLeft && x < spriteLeft + SPRITE_WIDTH) {
+            for (i = 0; i < GAME_SIZE; i++) {
+                if (shift[i] <= -SPRITE_HEIGHT || shift[i] >= 8) {
+                    continue;
+                }
+                if (x == spriteLeft || x == firstX) {
+                    marker[i] = cellView(i * GAME_SIZE + column);
+                }
+                bits |= spriteColumn(marker[i], i * GAME_SIZE + column, x - spriteLeft, shift[i]);
             }
         }
+        i2c_put(bits);
     }
-
-    drawMarker(markerX, markerY, currentPlayer);  // Highlight the current marker
 }
 
+// Top pixel row of the sprites in a grid row: on a page boundary when that keeps them clear of the grid lines
+unsigned int spriteTop(unsigned int y) {
+    unsigned int top = y * CELL_HEIGHT + (CELL_HEIGHT - SPRITE_HEIGHT + 1) / 2;  // Centred in the cell
+    unsigned int aligned = (top + 4) & ~7u;                                     // Nearest page boundary
+    unsigned int bottom = (y == GAME_SIZE - 1) ? SSD1306_LCDHEIGHT : (y + 1) * CELL_HEIGHT;  // Line below the cell, if any
 
-// Draw Marker (X or O) on the Grid
-void drawMarker(unsigned int x, unsigned int y, char marker) {
-    // Map grid coordinates to pixel positions
-    unsigned int pixelX = x * 42 + 14;  // Adjust for grid alignment
-    unsigned int pixelY = y * 21 + 7;
-
-    ssd1306_setPosition(pixelX, pixelY / 8);
-
-    // Draw the marker ('X' or 'O') on the grid
-    char markerStr[2] = {marker, '\0'};
-    ssd1306_printText(pixelX, pixelY / 8, markerStr);
+    if ((y == 0 || aligned > y * CELL_HEIGHT) && aligned + SPRITE_HEIGHT <= bottom) {
+        return aligned;  // Sprite maps straight onto whole pages
+    }
+    return top;
 }
 
-// Initialize Debounce Timer
-void initDebounceTimer() {
-    TA0CCTL0 = CCIE;              // Enable Timer A interrupt
-    TA0CCR0 = 50000;              // Set debounce interval (~10 ms)
-    TA0CTL = TASSEL_2 + MC_1;     // SMCLK, up mode
-}
+// One column of a cell's sprites within a page, the sprites starting shift rows below the page top.
+// A highlighted cell is drawn as a lit box with the marker cut out; the cursor corners go on top.
+unsigned char spriteColumn(char marker, unsigned int cell, unsigned int i, int shift) {
+    unsigned char invert = (highlightCells & GAME_BIT(cell)) ? 0xFF : 0x00;
+    unsigned char bits = 0x00;
+    unsigned int page;
 
-void startDebounceTimer() {
-    TA0R = 0;                     // Reset timer
-    TA0CTL |= MC_1;               // Start timer in up mode
-}
+    for (page = 0; page < SPRITE_PAGES; page++, shift += 8) {
+        unsigned char column = 0x00;
 
-#pragma vector=TIMER0_A0_VECTOR
-__interrupt void Timer_A(void) {
-    P1IE |= (BIT0 + BIT3);        // Re-enable button interrupts
-    TA0CTL &= ~MC_1;              // Stop timer
-    TA0CCTL0 &= ~CCIFG;           // Clear timer interrupt flag
+        if (shift <= -8 || shift >= 8) {
+            continue;  // This sprite page misses the display page
+        }
+        if (marker == 'X' || marker == 'x') {
+            column = sprites[SPRITE_X][page * SPRITE_WIDTH + i] ^ invert;
+        } else if (marker == 'O' || marker == 'o') {
+            column = sprites[SPRITE_O][page * SPRITE_WIDTH + i] ^ invert;
+        }
+        if (marker == 'x' || marker == 'o') {
+            column |= sprites[SPRITE_CURSOR][page * SPRITE_WIDTH + i];
+        }
+        bits |= (shift >= 0) ? column << shift : column >> -shift;
+    }
+    return bits;
 }
 
-// UART Initialization
-void initUART() {
-    P1SEL |= BIT1 + BIT2;  // Set P1.1, P1.2 to UART mode
-    P1SEL2 |= BIT1 + BIT2;
+// Draw the Tic Tac Toe Grid
+void drawGrid() {
+    unsigned int page, cell;
 
-    //UCA0CTL1 &= ~UCSWRST;  // Hold USCI in reset
-    UCA0CTL1 |= UCSSEL_2; // Use SMCLK
-    UCA0BR0 = 104;        // Set baud rate to 9600
-    UCA0BR1 = 0;
-    UCA0MCTL = UCBRS0;    // Modulation
-    UCA0CTL1 &= ~UCSWRST; // Release USCI for operation
+    TRACE_BEGIN(TRACE_DRAW_GRID);
 
-    IE2 |= UCA0RXIE;  // Enable RX and TX interrupts
-}
+    // Every page is rewritten in full, so the display does not need clearing first
+    ssd1306_setPosition(0, 0);
 
-// UART Transmit Data
-void transmitData(const char *data) {
-    unsigned int i = 0;
+    for (page = 0; page < SSD1306_LCDHEIGHT / 8; page++) {
+        i2c_begin(SSD1306_I2C_ADDRESS, 1 + SSD1306_LCDWIDTH);  // Control byte plus one full page of columns
+        i2c_put(SSD1306_CONTROL_DATA_STREAM);
+        renderGridPage(page, 0, SSD1306_LCDWIDTH);  // Address auto-advances to the next page
+    }
 
-    // Sequentially transmit each character in the string
-    while (data[i] != '\0') {        // Loop until the null terminator
-        while (!(IFG2 & UCA0TXIFG)); // Wait for TX buffer to be ready
-        UCA0TXBUF = data[i];         // Transmit the current character
-        i++;                         // Move to the next character
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        shownCells[cell] = cellView(cell);
     }
 
-    // Optionally send a null terminator explicitly
-    while (!(IFG2 & UCA0TXIFG));
-    UCA0TXBUF = '\0';
+    TRACE_END(TRACE_DRAW_GRID);
+}
 
-    __delay_cycles(50000);  // Add a small delay to ensure message is fully sent
+// Redraw one cell's sprite area from the board state, as one windowed burst over the pages it touches
+void drawCell(unsigned int x, unsigned int y) {
+    unsigned int firstPage = spriteTop(y) / 8;
+    unsigned int lastPage = (spriteTop(y) + SPRITE_HEIGHT - 1) / 8;
+    unsigned int page;
+
+    TRACE_BEGIN(TRACE_DRAW_CELL);
+    ssd1306_setWindow(SPRITE_LEFT(x), SPRITE_LEFT(x) + SPRITE_WIDTH - 1, firstPage, lastPage);  // Data wraps to the next page itself
+    i2c_begin(SSD1306_I2C_ADDRESS, 1 + (lastPage - firstPage + 1) * SPRITE_WIDTH);  // Control byte plus the sprite columns of every page
+    i2c_put(SSD1306_CONTROL_DATA_STREAM);
+    for (page = firstPage; page <= lastPage; page++) {
+        renderGridPage(page, SPRITE_LEFT(x), SPRITE_WIDTH);
+    }
+    TRACE_END(TRACE_DRAW_CELL);
 }
 
-// UART Receive Handler
-#pragma vector = USCIAB0RX_VECTOR
-__interrupt void USCI0RX_ISR(void) {
-    char receivedChar = UCA0RXBUF;  // Read the received character
+// What a cell should show: its marker, or the current player in lower case if it is the empty cell under the cursor
+char cellView(unsigned int cell) {
+    char marker = game_cell(cell);
 
-    if (rxIndex < sizeof(rxBuffer) - 1) {
-        rxBuffer[rxIndex++] = receivedChar;  // Add character to RX buffer
-    }
-    if (receivedChar == '\0') {  // Check for null terminator
-        dataReceived = 1;          // Set the data received flag
-        rxBuffer[rxIndex] = '\0';  // Null-terminate the string
-        //dataReceived = 1;          // Set the data received flag
-        rxIndex = 0;               // Reset the buffer index
+    if (marker == ' ' && cell == markerY * GAME_SIZE + markerX) {
+        marker = currentPlayer - 'A' + 'a';  // Previewed marker, drawn inside the cursor corners
     }
+    return marker;
 }
 
-// Handle Received Data
-void handleReceivedData() {
-    if (dataReceived) {
-        if (rxBuffer[0] == 'A') {  // Marker 'X' selected by the other board
-            currentPlayer = 'O';   // Assign this board as 'O'
-            gamePhase = 1;         // Transition to Gameplay Phase
-            updateLED(0);          // Turn off this board's LED as it's not this board's turn
-        }
-        else if (rxBuffer[0] == 'B') {  // Marker 'O' selected by the other board
-            currentPlayer = 'X';        // Assign this board as 'X'
-            gamePhase = 1;              // Transition to Gameplay Phase
-            updateLED(0);               // Turn off this board's LED as it's not this board's turn
-        }
-        else if (rxBuffer[0] == 'P') {  // Marker placement received
-            unsigned int x = rxBuffer[1] - '0';  // Extract X coordinate
-            unsigned int y = rxBuffer[2] - '0';  // Extract Y coordinate
-            char marker = rxBuffer[3];          // Extract marker ('X' or 'O')
-
-            grid[y][x] = marker;                // Update the grid
-            drawMarker(x, y, marker);           // Draw the marker on OLED
-            playBuzzer(1000, 200);              // Play placement sound
-            updateLED(1);                       // Turn on LED to indicate it's this board's turn
-        }
-        else if (rxBuffer[0] == 'R') {  // Reset game message received
-            resetGame();  // Trigger reset game
-        }
-        else if (rxBuffer[0] == 'G') {  // Winning message received
-            char winner = rxBuffer[1];  // Extract winner ('X' or 'O')
-            ssd1306_clearDisplay();
-            ssd1306_printText(0, 0, "Game Over!");
-
-            if (winner == 'X') {  // Check if X wins
-                ssd1306_printText(0, 2, "X Wins!");
-            } else if (winner == 'O') {  // Check if O wins
-                ssd1306_printText(0, 2, "O Wins!");
-            }
-
-            playEventSound('W');  // Play the winning sound
-            __delay_cycles(5000000);  // Display message for 5 seconds
+// Send only the cells whose visible state differs from what the OLED shows
+void refreshCells() {
+    unsigned int cell;
 
-            resetGame();  // Reset the game after showing the result
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        char view = cellView(cell);
+        if (view != shownCells[cell]) {
+            drawCell(cell % GAME_SIZE, cell / GAME_SIZE);
+            shownCells[cell] = view;
         }
-        else if (rxBuffer[0] == 'D') {  // Draw message received
-            ssd1306_clearDisplay();
-            ssd1306_printText(0, 0, "Game Over!");
-            ssd1306_printText(0, 2, "It's a Draw!");
-
-            playEventSound('D');  // Play the draw sound
-            __delay_cycles(5000000);  // Display message for 5 seconds
+    }
+}
 
-            resetGame();  // Reset the game after showing the result
+// Answer a resync request by merging the boards: take the other board's markers this one lacks, then send it
+// just the cells it lacks, or the whole board if that is shorter. A marker is never cleared, so a move each
+// board missed survives on both; where both hold different markers in one cell, the asking board's stands.
+void mergeBoard(const unsigned char *otherBoard) {
+    unsigned char packed[GAME_PACKED_SIZE];
+    unsigned char delta[GAME_PACKED_SIZE];
+    unsigned char count = 0;
+    unsigned int cell;
+
+    game_merge(otherBoard, 1);
+    refreshCells();
+
+    game_pack(packed);  // Now it only differs where the other board has an empty cell
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        unsigned char shift = (cell % 4) * 2;
+        if (((packed[cell / 4] ^ otherBoard[cell / 4]) >> shift) & 0x03) {
+            if (count == GAME_PACKED_SIZE) {
+                link_sendData(LINK_BOARD, packed, sizeof(packed));  // Full board is no longer than the delta
+                return;
+            }
+            delta[count++] = LINK_MOVE_PACK(cell % GAME_SIZE, cell / GAME_SIZE, game_cell(cell));
         }
+    }
 
-        // Reset RX buffer for the next message
-        rxBuffer[0] = '\0';       // Clear the first character of the RX buffer
-        rxIndex = 0;              // Reset RX buffer index
-        dataReceived = 0;         // Reset the flag after processing
+    if (count > 0) {
+        link_sendData(LINK_SYNC, delta, count);
     }
 }
 
-void moveMarker() {
-    // Clear the current marker highlight without altering existing markers
-    if (grid[markerY][markerX] == ' ') {
-        drawMarker(markerX, markerY, ' ');  // Clear the highlight
-    } else {
-        drawMarker(markerX, markerY, grid[markerY][markerX]);  // Redraw existing marker
+// Handle Received Data
+void handleReceivedData(const LinkMessage *message) {
+    if (singlePlayer) {
+        return;  // A board that turns up mid-game waits for the next one
     }
 
-    // Find the next empty cell
-    unsigned int startX = markerX, startY = markerY;
-    do {
-        // Move to the next position
-        markerX++;
-        if (markerX >= 3) {  // Move to the next row after the last column
-            markerX = 0;
-            markerY++;
-            if (markerY >= 3) {  // Wrap back to the first row after the last row
-                markerY = 0;
-            }
+    if (message->type == LINK_SELECT && message->data[0] == 'X') {  // Marker 'X' selected by the other board
+        currentPlayer = 'O';   // Assign this board as 'O'
+        gamePhase = 1;         // Transition to Gameplay Phase
+        hal_setLED(0);          // Turn off this board's LED as it's not this board's turn
+    }
+    else if (message->type == LINK_SELECT && message->data[0] == 'O') {  // Marker 'O' selected by the other board
+        currentPlayer = 'X';        // Assign this board as 'X'
+        gamePhase = 1;              // Transition to Gameplay Phase
+        hal_setLED(0);               // Turn off this board's LED as it's not this board's turn
+    }
+    else if (message->type == LINK_MOVE) {  // Marker placement received
+        unsigned int x = LINK_MOVE_X(message->data[0]);  // Extract X coordinate
+        unsigned int y = LINK_MOVE_Y(message->data[0]);  // Extract Y coordinate
+        char marker = LINK_MOVE_MARKER(message->data[0]);  // Extract marker ('X' or 'O')
+
+        if (y >= GAME_SIZE) {
+            return;  // Not a cell on this board
         }
 
-        // If we've looped back to the starting position, break to avoid infinite loop
-        if (markerX == startX && markerY == startY) {
-            break;
+        game_set(y * GAME_SIZE + x, marker);  // Update the grid
+        refreshCells();                     // Draw the marker on OLED
+        playEventSound('R');                // Play placement sound
+        hal_setLED(1);                       // Turn on LED to indicate it's this board's turn
+
+        if (message->length > 1 && message->data[1] != game_hash()) {
+            unsigned char packed[GAME_PACKED_SIZE];
+            game_pack(packed);
+            link_sendData(LINK_SYNC_REQ, packed, sizeof(packed));  // Boards disagree, ask the mover for its view
+        }
+    }
+    else if (message->type == LINK_SYNC_REQ && message->length == GAME_PACKED_SIZE) {  // Other board missed something
+        mergeBoard(message->data);
+    }
+    else if (message->type == LINK_SYNC) {  // Cells this board lacked, it already has the other board's view of the rest
+        unsigned char i;
+        for (i = 0; i < message->length; i++) {
+            unsigned char cell = message->data[i] & 0x3F;
+            if (cell < GAME_CELLS && game_cell(cell) == ' ') {
+                game_set(cell, LINK_MOVE_MARKER(message->data[i]));
+            }
         }
-    } while (grid[markerY][markerX] != ' ');  // Continue until an empty cell is found
+        refreshCells();
+    }
+    else if (message->type == LINK_BOARD && message->length == GAME_PACKED_SIZE) {  // The other board's whole grid
+        game_merge(message->data, 0);
+        refreshCells();
+    }
+    else if (message->type == LINK_RESET) {  // Reset game message received
+        resetGame(0);  // Trigger reset game, without echoing the reset back
+    }
+    else if (message->type == LINK_WIN) {  // Winning message received
+        char winner = message->data[0];  // Extract winner ('X' or 'O')
 
-    // Highlight the new position for navigation
-    if (grid[markerY][markerX] == ' ') {
-        drawMarker(markerX, markerY, currentPlayer);  // Highlight for navigation
-    } else {
-        drawMarker(markerX, markerY, grid[markerY][markerX]);  // Leave the placed marker as is
+        playEventSound('W');  // Play the winning sound
+        showResult(GAME_WIN, winner);  // Flash the line, then show the result; the game resets when it ends
     }
+    else if (message->type == LINK_DRAW) {  // Draw message received
+        playEventSound('D');  // Play the draw sound
+        showResult(GAME_DRAW, 0);  // Show the result; the game resets when it ends
+    }
+}
+
+void moveMarker() {
+    // Find the next empty cell, staying put if the board is full
+    unsigned char cell = game_nextEmpty(markerY * GAME_SIZE + markerX);
+    markerX = cell % GAME_SIZE;
+    markerY = cell / GAME_SIZE;
+
+    // Move the highlight; cells that look the same as before are not sent
+    refreshCells();
 
     // Play navigation buzzer
-    playBuzzer(400, 200);
+    playEventSound('N');
 }
 
 // Place Marker (Updated with UART)
 void placeMarker() {
-    if (grid[markerY][markerX] == ' ') {
-        grid[markerY][markerX] = currentPlayer;
-        drawMarker(markerX, markerY, currentPlayer);
+    TRACE_BEGIN(TRACE_PLACE_MARKER);
+    if (game_place(markerY * GAME_SIZE + markerX, currentPlayer)) {
+        refreshCells();  // The highlight already showed this marker, so usually nothing is sent
+
+        unsigned char move[2] = {LINK_MOVE_PACK(markerX, markerY, currentPlayer), game_hash()};
+        if (!singlePlayer) {
+            link_sendData(LINK_MOVE, move, sizeof(move));  // The hash lets the other board spot a missed move
+        }
+        checkWinCondition(markerY * GAME_SIZE + markerX);
+        playEventSound('P');
+        hal_setLED(0);
+
+        if (singlePlayer && !gameOver) {
+            playComputerMove();
+        }
+    }
+    TRACE_END(TRACE_PLACE_MARKER);
+}
+
+// Let the built-in opponent answer the player's move
+void playComputerMove() {
+    char computer = (currentPlayer == 'X') ? 'O' : 'X';
+    unsigned char cell = ai_chooseMove(computer, aiLevel);
 
-        char message[5] = {'P', markerX + '0', markerY + '0', currentPlayer, '\0'};
-        transmitData(message);
-        checkWinCondition();
- playBuzzer(1000, 300);
-        updateLED(0);
+    game_place(cell, computer);
+    refreshCells();
+    playEventSound('R');
+
+    if (checkWinCondition(cell) == GAME_ONGOING) {
+        hal_setLED(1);  // Back to the player
     }
 }
 
-// Button Interrupt Service Routine
-#pragma vector=PORT1_VECTOR
-__interrupt void Port_1(void) {
-    __delay_cycles(3000);
+// Handle a debounced button event in the main loop
+void handleButton(unsigned char input) {
+    unsigned char button = INPUT_BUTTON(input);
+    unsigned char kind = INPUT_KIND(input);
 
-    if (P1IFG & BIT0) {  // Button for Player 1
-        P1IE &= ~BIT0;
-        startDebounceTimer();
+    if (kind == INPUT_LONG || kind == INPUT_REPEAT) {
+        if (button != HAL_BUTTON_1 || gameOver || (gamePhase != 2 && gamePhase != 3)) {
+            return;  // Only navigation repeats: holding Btn 1 sweeps the cursor or the level
+        }
+    } else if (kind != INPUT_PRESS) {
+        return;  // Releases need no action
+    }
+
+    if (gameOver) {
+        resetGame(1);  // A press during the result skips the rest of it
+        return;
+    }
 
+    if (button == HAL_BUTTON_1) {  // Button for Player 1
         if (gamePhase == 0) {  // Marker Selection Phase
             currentPlayer = 'X';  // Assign Player 1 as 'X'
-            transmitData("A");    // Send 'A' to the other board
-            gamePhase = 1;        // Transition to Gameplay Phase
-            drawGrid();           // Draw the grid for the new game
-            updateLED(1);
+            link_send(LINK_SELECT, 'X');  // Tell the other board it plays 'O'
+            link_proposeBaud(LINK_FAST_BAUD);
+            gamePhase = 1;        // Transition to Gameplay Phase, the main loop draws the grid
+            hal_setLED(1);
         } else if (gamePhase == 2) {  // Gameplay Phase
             moveMarker();
-
+        } else if (gamePhase == 3) {  // Level Selection Phase
+            aiLevel = (aiLevel + 1) % AI_LEVELS;
+            displayLevelSelection();
+            playEventSound('N');
         }
-
-        P1IFG &= ~BIT0;
-    } else if (P1IFG & BIT3) {  // Button for Player 2
-        P1IE &= ~BIT3;
-        startDebounceTimer();
-
+    } else if (button == HAL_BUTTON_2) {  // Button for Player 2
         if (gamePhase == 0) {  // Marker Selection Phase
             currentPlayer = 'O';  // Assign Player 2 as 'O'
-            transmitData("B");    // Send 'B' to the other board
-            gamePhase = 1;        // Transition to Gameplay Phase
-            drawGrid();           // Draw the grid for the new game
-            updateLED(1);
+            link_send(LINK_SELECT, 'O');  // Tell the other board it plays 'X'
+            link_proposeBaud(LINK_FAST_BAUD);
+            gamePhase = 1;        // Transition to Gameplay Phase, the main loop draws the grid
+            hal_setLED(1);
         } else if (gamePhase == 2) {  // Gameplay Phase
             placeMarker();
-
+        } else if (gamePhase == 3) {  // Level Selection Phase
+            singlePlayer = 1;
+            ai_seed(hal_timerCount() ^ powerStats.wakeups);  // Button timing is the only entropy around
+            game_reset();  // Drop any moves made while the link was still trying
+            markerX = 0;
+            markerY = 0;
+            drawGrid();
+            gamePhase = 2;
+            if (currentPlayer == 'O') {
+                playComputerMove();  // X always opens
+            } else {
+                hal_setLED(1);
+            }
         }
-
-        P1IFG &= ~BIT3;
     }
 }
 
-// Check for Win Condition
-void checkWinCondition() {
-    int i, j;
-    int isDraw = 1; // Assume it's a draw unless proven otherwise
-
-    // Check rows and columns for a win
-    for (i = 0; i < 3; i++) {
-        if ((grid[i][0] == currentPlayer && grid[i][1] == currentPlayer && grid[i][2] == currentPlayer) ||
-            (grid[0][i] == currentPlayer && grid[1][i] == currentPlayer && grid[2][i] == currentPlayer)) {
-            gameOver = 1;
-
-            // Play winning sound
-            playEventSound('W');
+// Check for Win Condition after a marker was placed in the given cell
+unsigned char checkWinCondition(unsigned char cell) {
+    char player = game_cell(cell);
+    unsigned char result;
 
-            // Send "Game Over" and winner message to the other board
-            char message[5] = {'G', currentPlayer, '\0'};
-            transmitData(message);
+    TRACE_BEGIN(TRACE_CHECK_WIN);
+    result = game_result(cell);
 
-            // Display "Game Over" and winner on this board
-            ssd1306_clearDisplay();
-            ssd1306_printText(0, 0, "Game Over!");
-            ssd1306_printText(0, 2, currentPlayer == 'X' ? "X Wins!" : "O Wins!");
+    if (result == GAME_ONGOING) {
+        TRACE_END(TRACE_CHECK_WIN);
+        return result;
+    }
 
-            // Delay to display result for 5 seconds
-            __delay_cycles(5000000);
+    gameOver = 1;
 
-            resetPending = 1;  // Indicate reset is required
-            return;
+    // Play the result sound and tell the other board
+    if (result == GAME_WIN) {
+        playEventSound(player == currentPlayer ? 'W' : 'L');
+        if (!singlePlayer) {
+            link_send(LINK_WIN, player);
+        }
+    } else {
+        playEventSound('D');
+        if (!singlePlayer) {
+            link_send(LINK_DRAW, 0);
         }
     }
 
-    // Check diagonals for a win
-    if ((grid[0][0] == currentPlayer && grid[1][1] == currentPlayer && grid[2][2] == currentPlayer) ||
-        (grid[0][2] == currentPlayer && grid[1][1] == currentPlayer && grid[2][0] == currentPlayer)) {
-        gameOver = 1;
+    // Animate "Game Over" and the result on this board; the game resets when it ends
+    showResult(result, player);
 
-        // Send "Game Over" and winner message to the other board
-        char message[5] = {'G', currentPlayer, '\0'};
-        transmitData(message);
+    TRACE_END(TRACE_CHECK_WIN);
+    return result;
+}
 
-        // Display "Game Over" and winner on this board
-        ssd1306_clearDisplay();
-        ssd1306_printText(0, 0, "Game Over!");
-        ssd1306_printText(0, 2, currentPlayer == 'X' ? "X Wins!" : "O Wins!");
+// Result animation built on the panel's own invert, scroll and contrast: a few command bytes per step, no redraws.
+// Each step is a timer continuation, so the link and the buttons are served throughout.
+void showResult(unsigned char result, char player) {
+    unsigned int cell;
 
-        // Delay to display result for 5 seconds
-        __delay_cycles(5000000);
+    gameOver = 1;
+    resultOutcome = result;
+    resultWinner = player;
+    resultStep = 0;
 
-        resetPending = 1;  // Indicate reset is required
+    if (result != GAME_WIN) {
+        showBanner();
         return;
     }
 
-    // Check if any cell is still empty
-    for (i = 0; i < 3; i++) {
-        for (j = 0; j < 3; j++) {
-            if (grid[i][j] == ' ') {
-                isDraw = 0; // Not a draw if an empty cell is found
-                break;
-            }
+    // Draw the winning cells inverted, then flip the whole panel so the line and the rest of the board trade places
+    highlightCells = game_winningLine(player);
+    for (cell = 0; cell < GAME_CELLS; cell++) {
+        if (highlightCells & GAME_BIT(cell)) {
+            drawCell(cell % GAME_SIZE, cell / GAME_SIZE);
         }
-        if (!isDraw) break; // Exit the loop if we find an empty cell
     }
+    highlightCells = 0;
+    timer_start(flashStep, FLASH_MS, FLASH_MS);
+}
 
-    // If no win and no empty cells, it's a draw
-    if (isDraw) {
-        gameOver = 1;
+void flashStep() {
+    resultStep++;
+    ssd1306_invertDisplay(resultStep & 1);  // Two bytes on the bus per flash
 
-        // Play draw sound
-        playEventSound('D');
+    if (resultStep == FLASH_COUNT) {
+        timer_stop(flashStep);
+        showBanner();
+    }
+}
+
+// Print the result and let the controller scroll it, then fade out once the result time is up
+void showBanner() {
+    unsigned int bannerMs = RESULT_MS - FADE_MS;
 
-        // Notify the other board about the draw
-        transmitData("D"); // 'D' indicates a draw
+    if (resultOutcome == GAME_WIN) {
+        bannerMs -= FLASH_COUNT * FLASH_MS;
+    }
 
-        // Display "Game Over" and draw message on this board
-        ssd1306_clearDisplay();
-        ssd1306_printText(0, 0, "Game Over!");
+    ssd1306_clearDisplay();
+    ssd1306_printText(0, 0, "Game Over!");
+    if (resultOutcome == GAME_WIN) {
+        ssd1306_printText(0, 2, resultWinner == 'X' ? "X Wins!" : "O Wins!");
+    } else {
         ssd1306_printText(0, 2, "It's a Draw!");
+    }
+    ssd1306_startScroll(0, 2, 2, SSD1306_SCROLL_2_FRAMES);  // The result line runs across the panel by itself
 
-        // Delay to display result for 5 seconds
-        __delay_cycles(5000000);
+    resultStep = 0;
+    timer_start(fadeStep, bannerMs, FADE_MS / FADE_STEPS);
+}
 
-        resetPending = 1;  // Indicate reset is required
+// Dim the panel step by step, then reset; resetGame puts the contrast back
+void fadeStep() {
+    if (resultStep == FADE_STEPS) {
+        resetGame(1);
+        return;
     }
+
+    resultStep++;
+    ssd1306_setContrast(SSD1306_DEFAULT_CONTRAST - SSD1306_DEFAULT_CONTRAST * resultStep / FADE_STEPS);
 }
 
 // Reset the Game
-void resetGame() {
-    // Wait a bit before clearing the display and grid
-    __delay_cycles(1000000);  // Add a delay before resetting (optional)
+void resetGame(unsigned char notifyOther) {
+    // Drop what is left of the result animation
+    timer_stop(flashStep);
+    timer_stop(fadeStep);
 
     // Reset the game state
     gameOver = 0;
@@ -550,40 +680,23 @@ void resetGame() {
     waitingForReset = 0;
 
     // Clear the logical grid
-    int i, j;
-    for (i = 0; i < 3; i++) {
-        for (j = 0; j < 3; j++) {
-            grid[i][j] = ' ';  // Clear the grid
-        }
-    }
+    game_reset();
 
-    // Clear the OLED display and reset marker positions
+    // Stop the result animation, clear the OLED display and reset marker positions
+    ssd1306_stopScroll();
     ssd1306_clearDisplay();
+    ssd1306_invertDisplay(0);
+    ssd1306_setContrast(SSD1306_DEFAULT_CONTRAST);  // Only once the panel is blank, so the banner does not light up again
     markerX = 0;
     markerY = 0;
 
-    // Transition back to the player selection phase
-    gamePhase = 0;  // Reset game phase to player selection
-    displayPlayerSelection();
+    // Transition back to the player selection phase after a short blank pause
+    gamePhase = 4;
+    timer_start(startSelection, RESET_MS, 0);
 
     // Notify the other board to reset
-    transmitData("R");
-
-    // Reset the handled flag after player selection
-    resetHandled = 0;  // Allow future resets for new games
-}
-
-// Add this function to control the LED
-void updateLED(unsigned char isTurn) {
-    if (isTurn) {
-        P2OUT |= BIT3;  // Turn on LED when it's this board's turn
-    } else {
-        P2OUT &= ~BIT3;  // Turn off LED otherwise
+    if (notifyOther && !singlePlayer) {
+        link_send(LINK_RESET, 0);
     }
-}
-
-// Modify initLED() function to initialize the LED
-void initLED() {
-    P2DIR |= BIT3;  // Set P2.3 as output for LED
-    P2OUT &= ~BIT3; // Turn off LED initially
+    singlePlayer = 0;  // Look for another board again next game
 }
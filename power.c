@@ -0,0 +1,78 @@
+/*
+ * power.c
+ *
+ * Low power mode selection for the main loop, and a statistical count of
+ * how long the CPU spends awake. The watchdog runs as an interval timer
+ * from the VLO (it keeps ticking in LPM3) and each tick samples the
+ * status register of the code it interrupted. The same interval doubles
+ * as a coarse EVENT_TICK for modules that ask for it.
+ */
+
+#include "power.h"
+#include "events.h"
+#include "trace.h"
+#include <msp430.h>
+
+volatile PowerStats powerStats;
+volatile unsigned char tickRequests = 0;
+
+void initPowerStats(void) {
+    BCSCTL3 |= LFXT1S_2;                                                // ACLK = VLO, no crystal fitted
+    WDTCTL = WDT_ADLY_16;                                               // Interval mode, ACLK/512 (~40 ms on the VLO)
+    IE1 |= WDTIE;
+} // end initPowerStats
+
+// Sleep until an ISR wakes the main loop. Call with interrupts disabled;
+// they are enabled atomically with entering the low power mode.
+void enterLowPower(unsigned char needSMCLK) {
+    powerStats.wakeups++;
+
+    if (needSMCLK) {
+        __bis_SR_register(LPM0_bits + GIE);                             // Timer_A peripherals run from SMCLK
+    } else {
+        __bis_SR_register(LPM3_bits + GIE);                             // USCI requests SMCLK on its own when needed
+    }
+} // end enterLowPower
+
+// Fraction of samples that found the CPU awake, in 1/1000
+unsigned int awakePermille(void) {
+    unsigned long awake, total;
+
+    __disable_interrupt();
+    awake = powerStats.awakeSamples;
+    total = awake + powerStats.lpm0Samples + powerStats.lpm3Samples;
+    __enable_interrupt();
+
+    if (total == 0) {
+        return 0;
+    }
+    return (unsigned int)((awake * 1000) / total);
+} // end awakePermille
+
+void requestTicks(unsigned char mask) {
+    tickRequests |= mask;                                               // single BIS instruction, safe against the ISR
+} // end requestTicks
+
+void releaseTicks(unsigned char mask) {
+    tickRequests &= ~mask;
+} // end releaseTicks
+
+#pragma vector = WDT_VECTOR
+__interrupt void WDT_ISR(void) {
+    unsigned int sr = __get_SR_register_on_exit();
+
+    TRACE_BEGIN(TRACE_ISR_WDT);
+    if (!(sr & CPUOFF)) {
+        powerStats.awakeSamples++;
+    } else if (sr & SCG1) {
+        powerStats.lpm3Samples++;
+    } else {
+        powerStats.lpm0Samples++;
+    }
+
+    if (tickRequests) {
+        pushEvent(EVENT_TICK, 0);
+        __bic_SR_register_on_exit(LPM3_bits);                           // Wake the main loop to run the tick
+    }
+    TRACE_END(TRACE_ISR_WDT);
+}
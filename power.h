@@ -0,0 +1,36 @@
+/*
+ * power.h
+ */
+
+#ifndef POWER_H_
+#define POWER_H_
+
+/* ====================================================================
+ * Awake/Asleep Accounting
+ * ==================================================================== */
+typedef struct {
+    unsigned long awakeSamples;                                         // WDT ticks that found the CPU running
+    unsigned long lpm0Samples;                                          // ... asleep with SMCLK kept on
+    unsigned long lpm3Samples;                                          // ... asleep with only ACLK running
+    unsigned long wakeups;                                              // times the main loop went back to sleep
+} PowerStats;
+
+extern volatile PowerStats powerStats;
+
+/* ====================================================================
+ * Tick Requests: while any bit is set, each WDT interval posts EVENT_TICK
+ * ==================================================================== */
+#define TICK_LINK           0x01                                        // link layer retransmit timer
+
+extern volatile unsigned char tickRequests;
+
+/* ====================================================================
+ * Power Prototype Definitions
+ * ==================================================================== */
+void initPowerStats(void);
+void enterLowPower(unsigned char);
+unsigned int awakePermille(void);
+void requestTicks(unsigned char);
+void releaseTicks(unsigned char);
+
+#endif /* POWER_H_ */
@@ -0,0 +1,78 @@
+/*
+ * ram.h
+ *
+ * The G2553 has 512 bytes of RAM for all static data and the stack. Each
+ * module's share is worked out below from its size settings, laid out as
+ * the MSP430 compiler does (ints on even addresses), and the build stops
+ * if the total leaves less than RAM_STACK for the stack. A new static
+ * belongs in its module's line here.
+ *
+ * The deepest stack is the built-in opponent's reply: one search() frame
+ * per ply, below the main loop's calls down to ai_chooseMove and one
+ * interrupt on top. A frame holds the return address, the arguments past
+ * the fourth register and five saved registers; with 32-bit masks the
+ * board takes two registers per side and the frame grows. A reply
+ * searches no deeper than the empty cells left after the opening rule,
+ * nor than AI_MAX_DEPTH.
+ */
+
+#ifndef RAM_H_
+#define RAM_H_
+
+#include "uart.h"
+#include "i2c.h"
+#include "events.h"
+#include "tone.h"
+#include "link.h"
+#include "timer.h"
+#include "game.h"
+#include "ai.h"
+#include "trace.h"
+
+/* ====================================================================
+ * Budget
+ * ==================================================================== */
+#define RAM_SIZE            512
+#define RAM_MASK            (GAME_CELLS > 16 ? 4 : 2)                   // sizeof(GameMask)
+
+#define RAM_SEARCH_FRAME    (RAM_MASK == 4 ? 22 : 14)                   // bytes per search() ply
+#define RAM_SEARCH_DEPTH    (GAME_CELLS - 2 < AI_MAX_DEPTH ? GAME_CELLS - 2 : AI_MAX_DEPTH)
+#define RAM_CALL_CHAIN      48                                          // main() to ai_chooseMove, plus an ISR and its callee
+#define RAM_STACK           (RAM_SEARCH_FRAME * RAM_SEARCH_DEPTH + RAM_CALL_CHAIN)
+
+/* ====================================================================
+ * Static Data per Module
+ * ==================================================================== */
+#define RAM_UART            (UART_TX_SIZE + UART_RX_SIZE + 20)          // rings, UartStats and ten state bytes
+#define RAM_I2C             (I2C_QUEUE_SIZE + I2C_MAX_PENDING * 2 + 16) // queue, transactions, I2CStats and state
+#define RAM_EVENTS          (EVENT_QUEUE_SIZE * 2 + 4)
+#define RAM_TONE            (TONE_QUEUE_SIZE * 2 + 10)                  // note pointers and the playing note
+#define RAM_LINK            (LINK_QUEUE_SIZE * (2 + LINK_MAX_DATA) + 14)    // messages, LinkStats and eight state bytes
+#define RAM_TIMER           (TIMER_SLOTS * 6 + 8)
+#define RAM_POWER           18                                          // PowerStats and tickRequests
+#define RAM_INPUT           12                                          // two buttons
+#define RAM_AI              (GAME_CELLS + 5)                            // move order, seed and node count
+#define RAM_GAME            (2 * RAM_MASK)                              // the board
+#define RAM_HAL             4                                           // cycle count overflows and the clock level
+#define RAM_MAIN            (GAME_CELLS + RAM_MASK + 17)                // game state and the cells shown
+
+#if defined(TRACE_ENABLED) && !defined(HOST_BUILD)
+#define RAM_TRACE           (TRACE_SIZE * 3 + 6)
+#else
+#define RAM_TRACE           0
+#endif
+
+#if defined(BENCH_BUILD) && !defined(HOST_BUILD)
+#define RAM_BENCH           26                                          // prompt text and the timing overhead
+#else
+#define RAM_BENCH           0
+#endif
+
+#define RAM_STATIC          (RAM_UART + RAM_I2C + RAM_EVENTS + RAM_TONE + RAM_LINK + RAM_TIMER + RAM_POWER + RAM_INPUT + \
+                             RAM_AI + RAM_GAME + RAM_HAL + RAM_MAIN + RAM_TRACE + RAM_BENCH)
+
+#if !defined(HOST_BUILD) && (RAM_STATIC + RAM_STACK > RAM_SIZE)
+#error "Static data leaves less than RAM_STACK of the 512 bytes of RAM for the stack: shrink a queue or TRACE_SIZE"
+#endif
+
+#endif /* RAM_H_ */
@@ -0,0 +1,46 @@
+/*
+ * sprites.h
+ */
+
+#ifndef SPRITES_H_
+#define SPRITES_H_
+
+/* ====================================================================
+ * Cell Sprites: markers pre-rendered in the controller's page layout.
+ * Each sprite is SPRITE_PAGES pages of SPRITE_WIDTH columns, bit n of a
+ * byte is pixel row n of its page, so a whole sprite goes out as one
+ * burst through a COLUMNADDR/PAGEADDR window. The tables are static, so
+ * a second file including this header gets its own copy, not a clash.
+ * ==================================================================== */
+#if GAME_SIZE == 3
+#define SPRITE_WIDTH    16                                              // 42x21 cells
+#define SPRITE_HEIGHT   16
+#else
+#define SPRITE_WIDTH    8                                               // 32x16 and 25x12 cells
+#define SPRITE_HEIGHT   8
+#endif
+#define SPRITE_PAGES    (SPRITE_HEIGHT / 8)
+
+#define SPRITE_X        0
+#define SPRITE_O        1
+#define SPRITE_CURSOR   2                                               // Overlaid on the marker previewed under the cursor
+#define SPRITE_COUNT    3
+
+#if GAME_SIZE == 3
+static const unsigned char sprites[SPRITE_COUNT][SPRITE_PAGES * SPRITE_WIDTH] = {
+    {0x00, 0x00, 0x00, 0x18, 0x38, 0x70, 0xE0, 0xC0, 0xC0, 0xE0, 0x70, 0x38, 0x18, 0x00, 0x00, 0x00,  // X, page 0
+     0x00, 0x00, 0x00, 0x18, 0x1C, 0x0E, 0x07, 0x03, 0x03, 0x07, 0x0E, 0x1C, 0x18, 0x00, 0x00, 0x00},  // X, page 1
+    {0x00, 0x00, 0x00, 0xC0, 0xF0, 0x30, 0x18, 0x18, 0x18, 0x18, 0x30, 0xF0, 0xC0, 0x00, 0x00, 0x00,  // O, page 0
+     0x00, 0x00, 0x00, 0x03, 0x0F, 0x0C, 0x18, 0x18, 0x18, 0x18, 0x0C, 0x0F, 0x03, 0x00, 0x00, 0x00},  // O, page 1
+    {0x0F, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x01, 0x01, 0x0F,  // cursor corners, page 0
+     0xF0, 0x80, 0x80, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x80, 0x80, 0x80, 0xF0},  // cursor corners, page 1
+};
+#else
+static const unsigned char sprites[SPRITE_COUNT][SPRITE_PAGES * SPRITE_WIDTH] = {
+    {0x00, 0x42, 0x24, 0x18, 0x18, 0x24, 0x42, 0x00},  // X
+    {0x00, 0x3C, 0x66, 0x42, 0x42, 0x66, 0x3C, 0x00},  // O
+    {0xC3, 0x81, 0x00, 0x00, 0x00, 0x00, 0x81, 0xC3},  // cursor corners
+};
+#endif
+
+#endif /* SPRITES_H_ */
@@ -3,7 +3,7 @@
  */
 
 #include "ssd1306.h"
-#include <msp430.h>
+#include "i2c.h"
 #include <stdint.h>
 #include "font_5x7.h"
 
@@ -24,64 +24,58 @@ const unsigned char HcenterUL[] = {                                           //
                                25                                       // 10 digits and 3 separators
 };
 
-void ssd1306_init(void) {
-    // SSD1306 init sequence
-    ssd1306_command(SSD1306_DISPLAYOFF);                                // 0xAE
-    ssd1306_command(SSD1306_SETDISPLAYCLOCKDIV);                        // 0xD5
-    ssd1306_command(0x80);                                              // the suggested ratio 0x80
-
-    ssd1306_command(SSD1306_SETMULTIPLEX);                              // 0xA8
-    ssd1306_command(SSD1306_LCDHEIGHT - 1);
-
-    ssd1306_command(SSD1306_SETDISPLAYOFFSET);                          // 0xD3
-    ssd1306_command(0x0);                                               // no offset
-    ssd1306_command(SSD1306_SETSTARTLINE | 0x0);                        // line #0
-    ssd1306_command(SSD1306_CHARGEPUMP);                                // 0x8D
-    ssd1306_command(0x14);                                              // generate high voltage from 3.3v line internally
-    ssd1306_command(SSD1306_MEMORYMODE);                                // 0x20
-    ssd1306_command(0x00);                                              // 0x0 act like ks0108
-    ssd1306_command(SSD1306_SEGREMAP | 0x1);
-    ssd1306_command(SSD1306_COMSCANDEC);
-
-    ssd1306_command(SSD1306_SETCOMPINS);                                // 0xDA
-    ssd1306_command(0x12);
-    ssd1306_command(SSD1306_SETCONTRAST);                               // 0x81
-    ssd1306_command(0xCF);
-
-    ssd1306_command(SSD1306_SETPRECHARGE);                              // 0xd9
-    ssd1306_command(0xF1);
-    ssd1306_command(SSD1306_SETVCOMDETECT);                             // 0xDB
-    ssd1306_command(0x40);
-    ssd1306_command(SSD1306_DISPLAYALLON_RESUME);                       // 0xA4
-    ssd1306_command(SSD1306_NORMALDISPLAY);                             // 0xA6
-
-    ssd1306_command(SSD1306_DEACTIVATE_SCROLL);
+const unsigned char ssd1306_initSequence[] = {                             // Sent as a single command stream transaction
+    SSD1306_CONTROL_CMD_STREAM,
+    SSD1306_DISPLAYOFF,                                                 // 0xAE
+    SSD1306_SETDISPLAYCLOCKDIV, 0x80,                                   // 0xD5, the suggested ratio 0x80
+    SSD1306_SETMULTIPLEX, SSD1306_LCDHEIGHT - 1,                        // 0xA8
+    SSD1306_SETDISPLAYOFFSET, 0x0,                                      // 0xD3, no offset
+    SSD1306_SETSTARTLINE | 0x0,                                         // line #0
+    SSD1306_CHARGEPUMP, 0x14,                                           // 0x8D, generate high voltage from 3.3v line internally
+    SSD1306_MEMORYMODE, 0x00,                                           // 0x20, 0x0 act like ks0108
+    SSD1306_SEGREMAP | 0x1,
+    SSD1306_COMSCANDEC,
+    SSD1306_SETCOMPINS, 0x12,                                           // 0xDA
+    SSD1306_SETCONTRAST, SSD1306_DEFAULT_CONTRAST,                      // 0x81
+    SSD1306_SETPRECHARGE, 0xF1,                                         // 0xd9
+    SSD1306_SETVCOMDETECT, 0x40,                                        // 0xDB
+    SSD1306_DISPLAYALLON_RESUME,                                        // 0xA4
+    SSD1306_NORMALDISPLAY,                                              // 0xA6
+    SSD1306_DEACTIVATE_SCROLL,
+    SSD1306_DISPLAYON                                                   //--turn on oled panel
+};
 
-    ssd1306_command(SSD1306_DISPLAYON);                                 //--turn on oled panel
+void ssd1306_init(void) {
+    // SSD1306 init sequence, control byte included so it goes out straight from flash
+    i2c_write(SSD1306_I2C_ADDRESS, ssd1306_initSequence, sizeof(ssd1306_initSequence));
 } // end ssd1306_init
 
 void ssd1306_command(unsigned char command) {
-    buffer[0] = 0x80;
-    buffer[1] = command;
-
-    i2c_write(SSD1306_I2C_ADDRESS, buffer, 2);
+    i2c_begin(SSD1306_I2C_ADDRESS, 2);
+    i2c_put(SSD1306_CONTROL_CMD_SINGLE);
+    i2c_put(command);
 } // end ssd1306_command
 
+void ssd1306_commandList(const unsigned char *commands, uint8_t count) {
+    i2c_begin(SSD1306_I2C_ADDRESS, count + 1);
+    i2c_put(SSD1306_CONTROL_CMD_STREAM);                                // every following byte is a command
+    while (count > 0) {
+        i2c_put(*commands++);
+        count--;
+    }
+} // end ssd1306_commandList
+
 void ssd1306_clearDisplay(void) {
 
     ssd1306_setPosition(0, 0);
-    uint8_t i;
-    for (i = 64; i > 0; i--) {                                          // count down for loops when possible for ULP
+    uint8_t page;
+    for (page = 8; page > 0; page--) {                                  // count down for loops when possible for ULP
         uint8_t x;
-        for(x = 16; x > 0; x--) {
-            if (x == 1) {
-                buffer[x-1] = 0x40;
-            } else {
-                buffer[x-1] = 0x0;
-            }
+        i2c_begin(SSD1306_I2C_ADDRESS, SSD1306_LCDWIDTH + 1);           // one page per transfer, queued straight from here
+        i2c_put(SSD1306_CONTROL_DATA_STREAM);
+        for (x = SSD1306_LCDWIDTH; x > 0; x--) {
+            i2c_put(0x0);
         }
-
-        i2c_write(SSD1306_I2C_ADDRESS, buffer, 17);
     }
 } // end ssd1306_clearDisplay
 
@@ -94,70 +88,162 @@ void ssd1306_setPosition(uint8_t column, uint8_t page) {
         page = 0;                                                       // constrain page to upper limit
     }
 
-    ssd1306_command(SSD1306_COLUMNADDR);
-    ssd1306_command(column);                                            // Column start address (0 = reset)
-    ssd1306_command(SSD1306_LCDWIDTH-1);                                // Column end address (127 = reset)
-
-    ssd1306_command(SSD1306_PAGEADDR);
-    ssd1306_command(page);                                              // Page start address (0 = reset)
-    ssd1306_command(7);                                                 // Page end address
+    ssd1306_setWindow(column, SSD1306_LCDWIDTH - 1, page, 7);           // open to the end of the screen
 } // end ssd1306_setPosition
 
-void ssd1306_printText(uint8_t x, uint8_t y, char *ptString) {
-    ssd1306_setPosition(x, y);
+// Restrict writes to a rectangle; data wraps inside it column by column, then page by page
+void ssd1306_setWindow(uint8_t column, uint8_t lastColumn, uint8_t page, uint8_t lastPage) {
+    const unsigned char commands[6] = {
+        SSD1306_COLUMNADDR,
+        column,                                                         // Column start address (0 = reset)
+        lastColumn,                                                     // Column end address (127 = reset)
+        SSD1306_PAGEADDR,
+        page,                                                           // Page start address (0 = reset)
+        lastPage                                                        // Page end address (7 = reset)
+    };
+
+    ssd1306_commandList(commands, sizeof(commands));
+} // end ssd1306_setWindow
+
+// Show every pixel flipped (1) or as stored (0); GDDRAM itself is left alone
+void ssd1306_invertDisplay(uint8_t invert) {
+    ssd1306_command(invert ? SSD1306_INVERTDISPLAY : SSD1306_NORMALDISPLAY);
+} // end ssd1306_invertDisplay
+
+void ssd1306_setContrast(uint8_t contrast) {
+    const unsigned char commands[] = {SSD1306_SETCONTRAST, contrast};
+
+    ssd1306_commandList(commands, sizeof(commands));
+} // end ssd1306_setContrast
+
+// Let the controller scroll pages firstPage..lastPage sideways on its own, one column per interval (SSD1306_SCROLL_*)
+void ssd1306_startScroll(uint8_t left, uint8_t firstPage, uint8_t lastPage, uint8_t interval) {
+    const unsigned char commands[] = {
+        SSD1306_DEACTIVATE_SCROLL,                                      // setup is only taken while scroll is off
+        left ? SSD1306_LEFT_HORIZONTAL_SCROLL : SSD1306_RIGHT_HORIZONTAL_SCROLL,
+        0x00,                                                           // dummy byte
+        firstPage,
+        interval,
+        lastPage,
+        0x00, 0xFF,                                                     // dummy bytes
+        SSD1306_ACTIVATE_SCROLL
+    };
+
+    ssd1306_commandList(commands, sizeof(commands));
+} // end ssd1306_startScroll
+
+// The scrolled image is left in GDDRAM in an undefined state, redraw before showing anything else
+void ssd1306_stopScroll(void) {
+    ssd1306_command(SSD1306_DEACTIVATE_SCROLL);
+} // end ssd1306_stopScroll
 
-    while (*ptString != '\0') {
-        buffer[0] = 0x40;
+// Send columns left to right of a page as one data transfer, worked out column by column as they are queued:
+// glyphs of text from column x on, a blank sixth column between them, blank wherever there is no text
+static void sendText(int16_t x, uint8_t page, const char *text, uint8_t left, uint8_t right) {
+    int16_t column;
+    uint8_t i = 0;                                                      // column within the current glyph
 
-        if ((x + 5) >= 127) {                                           // char will run off screen
-            x = 0;                                                      // set column to 0
-            y++;                                                        // jump to next page
-            ssd1306_setPosition(x, y);                                  // send position change to oled
-        }
+    if (right >= SSD1306_LCDWIDTH) {
+        right = SSD1306_LCDWIDTH - 1;
+    }
+    if (right < left) {
+        return;
+    }
+    ssd1306_setPosition(left, page);
+    i2c_begin(SSD1306_I2C_ADDRESS, right - left + 2);                   // control byte plus the window
+    i2c_put(SSD1306_CONTROL_DATA_STREAM);
 
-        uint8_t i;
-        for(i = 0; i< 5; i++) {
-            buffer[i+1] = font_5x7[*ptString - ' '][i];
+    for (column = left; (column < x) && (column <= right); column++) {
+        i2c_put(0x00);                                                  // text starts right of the window edge
+    }
+    for (column = x; column <= right; column++) {
+        unsigned char bits = 0x00;
+        if ((*text != '\0') && (i < 5)) {
+            bits = font_5x7[*text - ' '][i];
+        }
+        if (++i == 6) {
+            i = 0;
+            if (*text != '\0') {
+                text++;
+            }
+        }
+        if (column >= left) {
+            i2c_put(bits);
         }
+    }
+} // end sendText
 
-        buffer[6] = 0x0;
+// Each line of text goes out as one transfer; the position is only sent again when the text wraps
+void ssd1306_printText(uint8_t x, uint8_t y, char *ptString) {
+    uint8_t start = x;                                                  // column the current line starts at
+    char *line = ptString;                                              // its first character
 
-        i2c_write(SSD1306_I2C_ADDRESS, buffer, 7);
+    while (*ptString != '\0') {
+        if ((x + 5) >= 127) {                                           // char will run off screen
+            if (x > start) {
+                sendText(start, y, line, start, x - 1);
+            }
+            x = start = 0;                                              // continue at column 0 of the next page
+            y++;
+            line = ptString;
+        }
         ptString++;
-        x+=6;
+        x += 6;                                                         // blank sixth column spaces the glyphs
+    }
+    if (x > start) {
+        sendText(start, y, line, start, x - 1);
     }
 } // end ssd1306_printText
 
+// Word-wrapped text, one transfer per line; spaces between words are sent as blank columns
 void ssd1306_printTextBlock(uint8_t x, uint8_t y, char *ptString) {
-    char word[12];
-    uint8_t i;
-    uint8_t endX = x;
-    while (*ptString != '\0'){
-        i = 0;
-        while ((*ptString != ' ') && (*ptString != '\0')) {
-            word[i] = *ptString;
-            ptString++;
-            i++;
-            endX += 6;
-        }
+    uint8_t start = x;                                                  // column the current line starts at
+    uint8_t end = x;                                                    // column after its last glyph
+    char *line = ptString;                                              // character at start
 
-        word[i++] = '\0';
+    while (*ptString != '\0') {
+        uint8_t length = 0;
+        while ((ptString[length] != ' ') && (ptString[length] != '\0')) {
+            length++;
+        }
 
-        if (endX >= 127) {
-            x = 0;
+        if ((x != start) && ((x + length * 6) >= 127)) {                // word does not fit behind the others
+            if (end > start) {
+                sendText(start, y, line, start, end - 1);
+            }
+            x = start = end = 0;
             y++;
-            ssd1306_printText(x, y, word);
-            endX = (i * 6);
-            x = endX;
-        } else {
-            ssd1306_printText(x, y, word);
-            endX += 6;
-            x = endX;
+            line = ptString;
         }
-        ptString++;
+
+        for (; length > 0; length--, ptString++) {
+            if ((x + 5) >= 127) {                                       // word longer than a line, break it
+                if (end > start) {
+                    sendText(start, y, line, start, end - 1);
+                }
+                x = start = end = 0;
+                y++;
+                line = ptString;
+            }
+            x += 6;
+            end = x;
+        }
+
+        if (*ptString == ' ') {
+            ptString++;
+            x += 6;
+        }
+    }
+    if (end > start) {
+        sendText(start, y, line, start, end - 1);
     }
+} // end ssd1306_printTextBlock
 
-}
+// Text from column x (may start left of the window) clipped to columns left..right of a page.
+// The whole window is sent, blank where there is no text, so it also erases what was there.
+void ssd1306_printTextClipped(int16_t x, uint8_t y, char *ptString, uint8_t left, uint8_t right) {
+    sendText(x, y, ptString, left, right);
+} // end ssd1306_printTextClipped
 
 
 void ssd1306_printUI32( uint8_t x, uint8_t y, uint32_t val, uint8_t Hcenter ) {
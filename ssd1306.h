@@ -5,12 +5,9 @@
 #ifndef SSD1306_H_
 #define SSD1306_H_
 
-#include <msp430.h>
 #include <stdint.h>
 #include <string.h>
 
-unsigned char buffer[17];                                                     // buffer for data transmission to screen
-
 /* ====================================================================
  * Horizontal Centering Number Array
  * ==================================================================== */
@@ -23,11 +20,16 @@ unsigned char buffer[17];                                                     //
 
 #define SSD1306_I2C_ADDRESS             0x3C
 
+#define SSD1306_CONTROL_CMD_SINGLE      0x80                            // Co = 1, D/C# = 0: one command follows
+#define SSD1306_CONTROL_CMD_STREAM      0x00                            // Co = 0, D/C# = 0: rest of transfer is commands
+#define SSD1306_CONTROL_DATA_STREAM     0x40                            // Co = 0, D/C# = 1: rest of transfer is GDDRAM data
+
 #define SSD1306_LCDWIDTH                128
 #define SSD1306_LCDHEIGHT               64
 #define SSD1306_128_64
 
 #define SSD1306_SETCONTRAST             0x81
+#define SSD1306_DEFAULT_CONTRAST        0xCF                            // contrast set by ssd1306_init
 #define SSD1306_DISPLAYALLON_RESUME     0xA4
 #define SSD1306_DISPLAYALLON            0xA5
 #define SSD1306_NORMALDISPLAY           0xA6
@@ -64,7 +66,7 @@ unsigned char buffer[17];                                                     //
 #define SSD1306_EXTERNALVCC             0x1
 #define SSD1306_SWITCHCAPVCC            0x2
 
-// currently no scroll functionality, left for possible future use
+// Continuous scroll runs in the controller; GDDRAM must be rewritten after it is stopped
 #define SSD1306_ACTIVATE_SCROLL                         0x2F
 #define SSD1306_DEACTIVATE_SCROLL                       0x2E
 #define SSD1306_SET_VERTICAL_SCROLL_AREA                0xA3
@@ -73,16 +75,30 @@ unsigned char buffer[17];                                                     //
 #define SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL    0x29
 #define SSD1306_VERTICAL_AND_LEFT_HORIZONTAL_SCROLL     0x2A
 
+// Scroll step intervals, in frames (about 100 per second with the init clock settings)
+#define SSD1306_SCROLL_2_FRAMES                         0x07
+#define SSD1306_SCROLL_3_FRAMES                         0x04
+#define SSD1306_SCROLL_5_FRAMES                         0x00
+#define SSD1306_SCROLL_25_FRAMES                        0x06
+#define SSD1306_SCROLL_64_FRAMES                        0x01
+
 
 /* ====================================================================
  * SSD1306 OLED Prototype Definitions
  * ==================================================================== */
 void ssd1306_init(void);
 void ssd1306_command(unsigned char);
+void ssd1306_commandList(const unsigned char *, uint8_t);
 void ssd1306_clearDisplay(void);
 void ssd1306_setPosition(uint8_t, uint8_t);
+void ssd1306_setWindow(uint8_t, uint8_t, uint8_t, uint8_t);
+void ssd1306_invertDisplay(uint8_t);
+void ssd1306_setContrast(uint8_t);
+void ssd1306_startScroll(uint8_t, uint8_t, uint8_t, uint8_t);
+void ssd1306_stopScroll(void);
 void ssd1306_printText(uint8_t, uint8_t, char *);
 void ssd1306_printTextBlock(uint8_t, uint8_t, char *);
+void ssd1306_printTextClipped(int16_t, uint8_t, char *, uint8_t, uint8_t);
 void ssd1306_printUI32(uint8_t, uint8_t, uint32_t, uint8_t);
 
 uint8_t digits(uint32_t);
@@ -0,0 +1,138 @@
+/*
+ * timer.c
+ *
+ * One-shot and periodic callbacks on the HAL tick. The tick ISR only
+ * counts, and posts EVENT_TIMER once the earliest deadline has passed;
+ * the callbacks run from the main loop in timer_run(), so they can draw,
+ * send and arm other timers like any other handler. The tick is only
+ * started while a timer is armed. A timer is known by its callback:
+ * starting one that is already armed moves its deadline.
+ */
+
+#include "timer.h"
+#include "events.h"
+
+typedef struct {
+    TimerCallback callback;                                             // 0 while the slot is free
+    unsigned int due;                                                   // tick the callback runs at
+    unsigned int period;                                                // ticks between runs, 0 for a one-shot
+} Timer;
+
+static Timer timers[TIMER_SLOTS];                                       // main loop only, no ISR access
+static volatile unsigned int now = 0;                                   // ticks counted, written only by the ISR
+static volatile unsigned int nextDue = 0;                               // earliest deadline, written only by the main loop
+static volatile unsigned char armed = 0;                                // nextDue is valid
+static volatile unsigned char duePosted = 0;                            // EVENT_TIMER queued and not yet run
+static unsigned char ticking = 0;
+
+// Round up, so a timer never runs early
+static unsigned int toTicks(unsigned int ms) {
+    unsigned int ticks = (ms + HAL_TICK_MS - 1) / HAL_TICK_MS;
+
+    return ticks ? ticks : 1;
+}
+
+// Find the earliest deadline and start or stop the tick to match
+static void schedule(void) {
+    unsigned int current = now;
+    unsigned int earliest = 0;
+    unsigned char found = 0;
+    unsigned char i;
+
+    for (i = 0; i < TIMER_SLOTS; i++) {
+        if (timers[i].callback) {
+            int left = (int)(timers[i].due - current);
+            if (left < 0) {
+                left = 0;                                               // overdue, the next tick posts it
+            }
+            if (!found || (unsigned int)left < earliest) {
+                earliest = left;
+                found = 1;
+            }
+        }
+    }
+
+    armed = 0;                                                          // keep the ISR off nextDue while it changes
+    if (found) {
+        nextDue = current + earliest;
+        armed = 1;
+        if (!ticking) {
+            hal_startTick();
+            ticking = 1;
+        }
+    } else if (ticking) {
+        hal_stopTick();
+        ticking = 0;
+    }
+}
+
+// Run callback after ms, then every periodMs if that is not 0; returns 0 if every slot is taken
+unsigned char timer_start(TimerCallback callback, unsigned int ms, unsigned int periodMs) {
+    Timer *slot = 0;
+    unsigned char i;
+
+    for (i = 0; i < TIMER_SLOTS; i++) {
+        if (timers[i].callback == callback) {
+            slot = &timers[i];                                          // already armed, move it
+            break;
+        }
+        if (!timers[i].callback && !slot) {
+            slot = &timers[i];
+        }
+    }
+    if (!slot) {
+        return 0;
+    }
+
+    slot->callback = callback;
+    slot->due = now + toTicks(ms);
+    slot->period = periodMs ? toTicks(periodMs) : 0;
+    schedule();
+    return 1;
+} // end timer_start
+
+void timer_stop(TimerCallback callback) {
+    unsigned char i;
+
+    for (i = 0; i < TIMER_SLOTS; i++) {
+        if (timers[i].callback == callback) {
+            timers[i].callback = 0;
+        }
+    }
+    schedule();
+} // end timer_stop
+
+// A timer is armed, so the tick (and the clock behind it) has to keep running
+unsigned char timer_active(void) {
+    return armed;
+} // end timer_active
+
+// Main loop side, on EVENT_TIMER: run every callback whose deadline has passed
+void timer_run(void) {
+    unsigned char i;
+
+    duePosted = 0;
+    for (i = 0; i < TIMER_SLOTS; i++) {
+        TimerCallback callback = timers[i].callback;
+
+        if (callback && (int)(timers[i].due - now) <= 0) {
+            if (timers[i].period) {
+                timers[i].due += timers[i].period;
+            } else {
+                timers[i].callback = 0;                                 // free before the call, it may start itself again
+            }
+            callback();
+        }
+    }
+    schedule();
+} // end timer_run
+
+// Tick ISR side: returns 1 if the main loop has to wake up for timer_run()
+unsigned char timer_tick(void) {
+    now++;
+    if (armed && !duePosted && (int)(now - nextDue) >= 0 && pushEvent(EVENT_TIMER, 0)) {
+        duePosted = 1;
+        return 1;
+    }
+    return 0;
+} // end timer_tick
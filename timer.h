@@ -0,0 +1,26 @@
+/*
+ * timer.h
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include "hal.h"
+
+/* ====================================================================
+ * Soft Timer Settings
+ * ==================================================================== */
+#define TIMER_SLOTS         3                                           // callbacks that can be armed at once
+
+typedef void (*TimerCallback)(void);
+
+/* ====================================================================
+ * Timer Prototype Definitions
+ * ==================================================================== */
+unsigned char timer_start(TimerCallback, unsigned int, unsigned int);
+void timer_stop(TimerCallback);
+unsigned char timer_active(void);
+void timer_run(void);
+unsigned char timer_tick(void);
+
+#endif /* TIMER_H_ */
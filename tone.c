@@ -0,0 +1,151 @@
+/*
+ * tone.c
+ *
+ * Background tone generator for the buzzer on P1.4. P1.4 has no Timer_A
+ * output on the G2553, so Timer1_A runs in up mode at half the note
+ * period and its CCR0 interrupt toggles the pin. Notes are queued and
+ * played back from the interrupt; the CPU is free (or in LPM0) meanwhile.
+ * The queue keeps pointers to the notes, so melodies are const tables that
+ * stay in flash.
+ */
+
+#include "tone.h"
+#include "clock.h"
+#include <msp430.h>
+
+static const unsigned long timerHz[CLOCK_LEVELS] = {                    // Timer1_A clock (SMCLK) per clock level
+    CLOCK_SMCLK_HZ(CLOCK_1MHZ),
+    CLOCK_SMCLK_HZ(CLOCK_8MHZ),
+    CLOCK_SMCLK_HZ(CLOCK_16MHZ)
+};
+
+static const Note *queue[TONE_QUEUE_SIZE];                              // notes by address, two bytes each
+static volatile unsigned char queueHead = 0;                            // written by playMelody
+static volatile unsigned char queueTail = 0;                            // written by the Timer1_A ISR
+
+static volatile unsigned long ticksLeft = 0;                            // CCR0 periods left in the current note
+static volatile unsigned char sounding = 0;                             // current note toggles the pin
+static volatile unsigned char playing = 0;                              // timer is running
+static unsigned int noteFrequency;                                      // of the current note, TONE_REST for a pause
+
+// Timer1_A CCR0 for a note at the current clock level: half its period, or 1 ms for a pause
+static unsigned int notePeriod(unsigned int frequency) {
+    if (frequency == TONE_REST) {
+        return timerHz[clock_level()] / 1000 - 1;
+    }
+    return timerHz[clock_level()] / frequency / 2 - 1;                  // toggle twice per period
+}
+
+// Load the next queued note into Timer1_A, returns 0 when the queue is empty
+static unsigned char startNext(void) {
+    if (queueTail == queueHead) {
+        TA1CTL = MC_0;                                                  // Stop timer
+        TA1CCTL0 = 0;
+        P1OUT &= ~BIT4;                                                 // Leave the buzzer off
+        sounding = 0;
+        playing = 0;
+        return 0;
+    }
+
+    unsigned int frequency = queue[queueTail]->frequency;
+    unsigned int duration = queue[queueTail]->duration;
+    queueTail = (queueTail + 1) & (TONE_QUEUE_SIZE - 1);
+
+    noteFrequency = frequency;
+    TA1CCR0 = notePeriod(frequency);
+    if (frequency == TONE_REST) {
+        ticksLeft = duration;                                           // count milliseconds
+        sounding = 0;
+        P1OUT &= ~BIT4;
+    } else {
+        ticksLeft = (2UL * frequency * duration) / 1000;
+        sounding = 1;
+    }
+
+    if (ticksLeft == 0) {
+        ticksLeft = 1;
+    }
+
+    TA1R = 0;
+    TA1CCTL0 = CCIE;
+    TA1CTL = TASSEL_2 + MC_1;                                           // SMCLK, up mode
+    playing = 1;
+    return 1;
+}
+
+// Initialize Buzzer
+void initBuzzer(void) {
+    P1DIR |= BIT4;  // Set P1.4 as output for buzzer
+    P1OUT &= ~BIT4; // Turn off buzzer initially
+    TA1CTL = MC_0;
+}
+
+// Queue notes behind whatever is playing, returns how many fit in the queue; the notes must outlive their playback
+unsigned char playMelody(const Note *notes, unsigned char count) {
+    unsigned char queued = 0;
+    unsigned short state = __get_interrupt_state();
+    __disable_interrupt();
+
+    while ((queued < count) && (((queueHead + 1) & (TONE_QUEUE_SIZE - 1)) != queueTail)) {
+        queue[queueHead] = &notes[queued++];
+        queueHead = (queueHead + 1) & (TONE_QUEUE_SIZE - 1);
+    }
+
+    if (!playing) {
+        startNext();
+    }
+
+    __set_interrupt_state(state);
+    return queued;
+}
+
+// Queue one note, unless that note is already the last one waiting to play: a repeat that comes faster than
+// the note then stands in for the one queued before it instead of piling up behind it; notes queued for
+// anything else are left alone. Returns 1 once the note is waiting.
+unsigned char playNote(const Note *note) {
+    unsigned char queued = 1;
+    unsigned short state = __get_interrupt_state();
+    __disable_interrupt();
+
+    if ((queueHead == queueTail) || (queue[(queueHead - 1) & (TONE_QUEUE_SIZE - 1)] != note)) {
+        queued = playMelody(note, 1);
+    }
+
+    __set_interrupt_state(state);
+    return queued;
+}
+
+// Silence the buzzer and drop every queued note
+void stopBuzzer(void) {
+    unsigned short state = __get_interrupt_state();
+    __disable_interrupt();
+    queueTail = queueHead;
+    startNext();
+    __set_interrupt_state(state);
+}
+
+// Keep the current note at its pitch after SMCLK has changed
+void tone_applyClock(void) {
+    unsigned short state = __get_interrupt_state();
+    __disable_interrupt();
+    if (playing) {
+        TA1CCR0 = notePeriod(noteFrequency);
+        TA1R = 0;                                                       // in case the count is already past the new period
+    }
+    __set_interrupt_state(state);
+}
+
+unsigned char buzzerBusy(void) {
+    return playing;
+}
+
+#pragma vector = TIMER1_A0_VECTOR
+__interrupt void Timer1_A0(void) {
+    if (sounding) {
+        P1OUT ^= BIT4;                                                  // Square wave on the buzzer pin
+    }
+
+    if (--ticksLeft == 0 && !startNext()) {
+        __bic_SR_register_on_exit(LPM3_bits);                           // let the main loop sleep deeper
+    }
+}
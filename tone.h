@@ -0,0 +1,29 @@
+/*
+ * tone.h
+ */
+
+#ifndef TONE_H_
+#define TONE_H_
+
+/* ====================================================================
+ * Buzzer Settings
+ * ==================================================================== */
+#define TONE_QUEUE_SIZE     8                                           // queued notes, must be a power of two
+#define TONE_REST           0                                           // frequency of a silent note
+
+typedef struct {
+    unsigned int frequency;                                             // Hz, TONE_REST for a pause
+    unsigned int duration;                                              // ms
+} Note;
+
+/* ====================================================================
+ * Buzzer Prototype Definitions
+ * ==================================================================== */
+void initBuzzer(void);
+unsigned char playMelody(const Note *, unsigned char);
+unsigned char playNote(const Note *);
+void stopBuzzer(void);
+unsigned char buzzerBusy(void);
+void tone_applyClock(void);
+
+#endif /* TONE_H_ */
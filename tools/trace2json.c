@@ -0,0 +1,192 @@
+/*
+ * trace2json.c
+ *
+ * Turns a trace dump into Chrome trace JSON, for chrome://tracing or
+ * ui.perfetto.dev. The input is the raw UART capture of a TRACE_ENABLED
+ * board answering a LINK_TRACE request (or host -t output); frames that
+ * are not trace frames or fail the CRC are skipped. Each dump in the
+ * capture becomes its own process. Interrupts go on their own track, as
+ * they pre-empt whatever the main loop was doing.
+ *
+ * The 16-bit timestamps are unwrapped on the assumption that events are
+ * less than one timer period (0.52 s) apart.
+ *
+ *   gcc -std=c99 -O2 -I. -o trace2json tools/trace2json.c crc.c
+ *   ./trace2json -r > /dev/ttyUSB0         # ask the board for a dump
+ *   ./trace2json capture.bin > trace.json
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+#include "uart.h"
+#include "link.h"
+#include "crc.h"
+
+#define TRACK_MAIN      0
+#define TRACK_ISR       1
+#define MAX_DEPTH       16                                              // open begin events per track
+
+static const char *const names[128] = {
+    [TRACE_ISR_PORT1]    = "Port_1 ISR",
+    [TRACE_ISR_TICK]     = "Timer0_A CCR0 ISR (soft-timer tick)",
+    [TRACE_ISR_SCAN]     = "Timer0_A CCR1 ISR (button scan)",
+    [TRACE_ISR_USCI_TX]  = "USCI TX ISR",
+    [TRACE_ISR_USCI_RX]  = "USCI_A0 RX ISR",
+    [TRACE_ISR_WDT]      = "WDT ISR",
+    [TRACE_I2C_WRITE]    = "i2c_write",
+    [TRACE_LINK_SEND]    = "link_sendData",
+    [TRACE_HANDLE_RX]    = "handleReceivedData",
+    [TRACE_DRAW_GRID]    = "drawGrid",
+    [TRACE_CHECK_WIN]    = "checkWinCondition",
+    [TRACE_PLACE_MARKER] = "placeMarker",
+    [TRACE_DRAW_CELL]    = "drawCell",
+};
+
+typedef struct {
+    unsigned char open[MAX_DEPTH];                                      // IDs begun and not yet ended
+    unsigned int depth;
+} Track;
+
+static unsigned int dumps = 0;
+static unsigned int remaining = 0;                                      // events still expected in the current dump
+static unsigned int lastStamp = 0;
+static unsigned long long ticks = 0;                                    // unwrapped time of the last event
+static unsigned char started = 0;                                       // an event has been seen in this dump
+static Track tracks[2];
+static const char *separator = "";
+
+static unsigned char isInterrupt(unsigned char id) {
+    return id >= TRACE_ISR_PORT1 && id <= TRACE_ISR_WDT;
+}
+
+static void emit(const char *phase, unsigned char id, unsigned int track) {
+    double us = (double)ticks * 1e6 / TRACE_TICK_HZ;
+
+    if (names[id]) {
+        printf("%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.1f,\"pid\":%u,\"tid\":%u}",
+               separator, names[id], phase, us, dumps, track);
+    } else {
+        printf("%s\n{\"name\":\"event %u\",\"ph\":\"%s\",\"ts\":%.1f,\"pid\":%u,\"tid\":%u}",
+               separator, id, phase, us, dumps, track);
+    }
+    separator = ",";
+}
+
+static void event(unsigned char code, unsigned int stamp) {
+    unsigned char id = code & ~TRACE_END_BIT;
+    unsigned int trackId = isInterrupt(id) ? TRACK_ISR : TRACK_MAIN;
+    Track *track = &tracks[trackId];
+
+    if (started) {
+        ticks += (unsigned int)((stamp - lastStamp) & 0xFFFF);
+    }
+    lastStamp = stamp;
+    started = 1;
+
+    if (!(code & TRACE_END_BIT)) {
+        if (track->depth < MAX_DEPTH) {
+            track->open[track->depth++] = id;
+        }
+        emit("B", id, trackId);
+    } else if (track->depth && track->open[track->depth - 1] == id) {
+        track->depth--;
+        emit("E", id, trackId);
+    }
+    // An end whose begin was overwritten in the ring is dropped, so the tracks stay nested
+}
+
+static void startDump(const unsigned char *payload) {
+    unsigned int count = payload[1] | (payload[2] << 8);
+    unsigned int lost = payload[3] | (payload[4] << 8);
+    unsigned int i;
+
+    dumps++;
+    remaining = count;
+    ticks = 0;
+    started = 0;
+    memset(tracks, 0, sizeof(tracks));
+
+    fprintf(stderr, "dump %u: %u events, %u lost to wrap-around\n", dumps, count, lost);
+    for (i = 0; i < 2; i++) {
+        printf("%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+               separator, dumps, i, (i == TRACK_ISR) ? "interrupts" : "main loop");
+        separator = ",";
+    }
+}
+
+static void frame(const unsigned char *payload, unsigned char length) {
+    unsigned char i;
+
+    if (length < 1 || (payload[0] >> 4) != LINK_TRACE) {
+        return;                                                         // link traffic, not part of a dump
+    }
+    if (remaining == 0) {
+        if (length == 5) {
+            startDump(payload);
+        }
+        return;
+    }
+    for (i = 1; i + 2 < length && remaining; i += 3) {
+        event(payload[i], payload[i + 1] | (payload[i + 2] << 8));
+        remaining--;
+    }
+}
+
+// Pick frames out of the capture the way the board's receiver does
+static void parse(FILE *file) {
+    unsigned char payload[UART_MAX_FRAME];
+    int c;
+
+    while ((c = fgetc(file)) != EOF) {
+        unsigned char length, crc, i;
+
+        if (c != UART_SYNC) {
+            continue;
+        }
+        if ((c = fgetc(file)) == EOF || c == 0 || c > UART_MAX_FRAME) {
+            continue;
+        }
+        length = (unsigned char)c;
+        crc = crc8(0, length);
+        for (i = 0; i < length && (c = fgetc(file)) != EOF; i++) {
+            payload[i] = (unsigned char)c;
+            crc = crc8(crc, payload[i]);
+        }
+        if (i == length && (c = fgetc(file)) != EOF && c == crc) {
+            frame(payload, length);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    FILE *file = stdin;
+
+    if (argc == 2 && strcmp(argv[1], "-r") == 0) {
+        unsigned char request = LINK_TRACE << 4;
+
+        putchar(UART_SYNC);                                             // a one-byte LINK_TRACE frame
+        putchar(1);
+        putchar(request);
+        putchar(crc8(crc8(0, 1), request));
+        return 0;
+    }
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-')) {
+        fprintf(stderr, "usage: %s [-r | capture]\n", argv[0]);
+        return 2;
+    }
+    if (argc == 2 && (file = fopen(argv[1], "rb")) == NULL) {
+        perror(argv[1]);
+        return 2;
+    }
+
+    printf("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    parse(file);
+    printf("\n]}\n");
+
+    if (dumps == 0) {
+        fprintf(stderr, "no trace dump found\n");
+        return 1;
+    }
+    return 0;
+}
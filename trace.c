@@ -0,0 +1,87 @@
+/*
+ * trace.c
+ *
+ * Flight recorder for timing: every TRACE_BEGIN/TRACE_END stores its ID
+ * and the free-running Timer0_A count in a ring that keeps the newest
+ * TRACE_SIZE events. Both ISRs and the main loop record, so the main
+ * loop's writes hold interrupts off for the few instructions they take.
+ * trace_dump() sends the ring as UART frames for tools/trace2json.c and
+ * starts it over.
+ *
+ * Timer0_A runs from SMCLK, which stops in LPM3: time spent there does
+ * not show up, and a gap of more than 0.5 s between two events folds.
+ */
+
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+
+#include "hal.h"
+#include "uart.h"
+
+#if (1 + TRACE_PER_FRAME * 3) > UART_MAX_FRAME
+#error "a trace frame must fit in one UART frame"
+#endif
+
+static unsigned int times[TRACE_SIZE];
+static unsigned char ids[TRACE_SIZE];
+static unsigned int next = 0;                                           // slot the next event goes in
+static unsigned int lost = 0;                                           // events overwritten since the last dump
+static unsigned char full = 0;                                          // the ring has wrapped
+static volatile unsigned char dumping = 0;                              // keep the dump's own UART ISRs out
+
+void trace_record(unsigned char id) {
+    unsigned int state;
+
+    if (dumping) {
+        return;
+    }
+
+    state = hal_saveInterrupts();
+    times[next] = hal_timerCount();
+    ids[next] = id;
+    next = (next + 1) & (TRACE_SIZE - 1);
+    if (full) {
+        lost++;
+    } else if (next == 0) {
+        full = 1;
+    }
+    hal_restoreInterrupts(state);
+} // end trace_record
+
+// Send the header and the events, oldest first, as frames starting with type; then empty the ring
+void trace_dump(unsigned char type, void (*send)(const unsigned char *, unsigned char)) {
+    unsigned char frame[1 + TRACE_PER_FRAME * 3];
+    unsigned int count, index, i;
+    unsigned char length;
+
+    dumping = 1;
+    count = full ? TRACE_SIZE : next;
+    index = full ? next : 0;
+
+    frame[0] = type;
+    frame[1] = count & 0xFF;
+    frame[2] = count >> 8;
+    frame[3] = lost & 0xFF;
+    frame[4] = lost >> 8;
+    send(frame, 5);
+
+    length = 1;
+    for (i = 0; i < count; i++) {
+        frame[length++] = ids[index];
+        frame[length++] = times[index] & 0xFF;
+        frame[length++] = times[index] >> 8;
+        index = (index + 1) & (TRACE_SIZE - 1);
+        if (length == sizeof(frame) || i + 1 == count) {
+            send(frame, length);
+            length = 1;
+        }
+    }
+
+    next = 0;
+    lost = 0;
+    full = 0;
+    dumping = 0;
+} // end trace_dump
+
+#endif /* TRACE_ENABLED */
@@ -0,0 +1,75 @@
+/*
+ * trace.h
+ *
+ * Build with -DTRACE_ENABLED to record timestamped begin/end events into
+ * a RAM ring. Without it the macros expand to nothing and trace.c is
+ * empty, so release builds carry no code or RAM for it.
+ *
+ * The buzzer's Timer1_A ISR is not traced: it runs at twice the note
+ * frequency and would flush the ring within a few milliseconds.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include "clock.h"
+
+/* ====================================================================
+ * Trace Settings
+ * ==================================================================== */
+#ifndef TRACE_SIZE
+#define TRACE_SIZE          8                                           // events kept, must be a power of two; counted in ram.h
+#endif
+
+#ifndef TRACE_IDS
+#define TRACE_IDS           0xFFFF                                      // bit n set records event ID n
+#endif
+
+#define TRACE_TICK_HZ       (CLOCK_SMCLK_HZ(CLOCK_IDLE) / 8)            // timestamps count Timer0_A, SMCLK/8; twice as fast during a 16 MHz boost
+
+/* ====================================================================
+ * Trace Event IDs (bit 7 set on the matching end event)
+ * ==================================================================== */
+#define TRACE_ISR_PORT1     1
+#define TRACE_ISR_TICK      2                                           // Timer0_A CCR0, soft-timer tick
+#define TRACE_ISR_SCAN      3                                           // Timer0_A CCR1, button scan
+#define TRACE_ISR_USCI_TX   4                                           // UART and I2C transmit
+#define TRACE_ISR_USCI_RX   5
+#define TRACE_ISR_WDT       6
+#define TRACE_I2C_WRITE     7
+#define TRACE_LINK_SEND     8                                           // link_sendData, the move/message send path
+#define TRACE_HANDLE_RX     9                                           // handleReceivedData
+#define TRACE_DRAW_GRID     10
+#define TRACE_CHECK_WIN     11                                          // checkWinCondition
+#define TRACE_PLACE_MARKER  12                                          // placeMarker
+#define TRACE_DRAW_CELL     13                                          // drawCell, one marker redrawn
+
+#define TRACE_END_BIT       0x80
+
+/* ====================================================================
+ * Dump Format: one header frame, type byte then the event count and the
+ * events lost to wrap-around (both little-endian 16-bit), followed by
+ * frames of up to TRACE_PER_FRAME events, each the ID and then its
+ * 16-bit little-endian timestamp, oldest first
+ * ==================================================================== */
+#define TRACE_PER_FRAME     2
+
+#ifdef TRACE_ENABLED
+
+#define TRACE_BEGIN(id)     do { if (TRACE_IDS & (1U << (id))) trace_record(id); } while (0)
+#define TRACE_END(id)       do { if (TRACE_IDS & (1U << (id))) trace_record((id) | TRACE_END_BIT); } while (0)
+
+/* ====================================================================
+ * Trace Prototype Definitions
+ * ==================================================================== */
+void trace_record(unsigned char);
+void trace_dump(unsigned char, void (*)(const unsigned char *, unsigned char));
+
+#else
+
+#define TRACE_BEGIN(id)     ((void)0)
+#define TRACE_END(id)       ((void)0)
+
+#endif /* TRACE_ENABLED */
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,265 @@
+/*
+ * uart.c
+ *
+ * USCI_A0 UART link to the other board. Transmit goes through a ring
+ * buffer that the TX interrupt drains, so sending a frame only costs the
+ * copy.
+ *
+ * Receive hunts for UART_SYNC, then collects LEN payload bytes and checks
+ * the CRC-8 (polynomial 0x07) before publishing the frame into a ring that
+ * can hold several complete frames. Frames hit by a line error, a bad
+ * length or CRC, or not fitting in the ring are discarded whole and
+ * counted in uartStats; the receiver then hunts for the next SYNC.
+ */
+
+#include "uart.h"
+#include "clock.h"
+#include "crc.h"
+#include "events.h"
+#include "trace.h"
+#include <msp430.h>
+
+#define RX_HUNT     0                                                   // waiting for SYNC
+#define RX_LENGTH   1                                                   // next byte is LEN
+#define RX_PAYLOAD  2                                                   // collecting payload
+#define RX_CRC      3                                                   // next byte is the CRC
+
+// UCA0BR0, UCA0BR1 and UCA0MCTL for one rate, then for every UART_BAUD_* in order
+#define DIVIDERS(level, rate)   {CLOCK_UART_BR(level, rate) & 0xFF, CLOCK_UART_BR(level, rate) >> 8, CLOCK_UART_BRS(level, rate) << 1}
+#define BAUD_ROW(level)         {DIVIDERS(level, 9600), DIVIDERS(level, 19200), DIVIDERS(level, 38400), \
+                                 DIVIDERS(level, 57600), DIVIDERS(level, 115200)}
+
+volatile UartStats uartStats;
+
+static const unsigned char baudTable[CLOCK_LEVELS][UART_BAUDS][3] = {    // per clock level, built from CLOCK_SMCLK_HZ
+    BAUD_ROW(CLOCK_1MHZ),
+    BAUD_ROW(CLOCK_8MHZ),
+    BAUD_ROW(CLOCK_16MHZ)
+};
+
+static unsigned char baud = UART_BAUD_9600;
+
+static unsigned char txQueue[UART_TX_SIZE];
+static volatile unsigned char txHead = 0;                               // written by uart_write
+static volatile unsigned char txTail = 0;                               // written by the TX ISR
+static volatile unsigned char txWaiting = 0;                            // main context sleeps until the ISR makes progress
+
+static unsigned char rxQueue[UART_RX_SIZE];                             // LEN followed by the payload, per frame
+static volatile unsigned char rxHead = 0;                               // end of the last complete frame
+static volatile unsigned char rxTail = 0;                               // start of the oldest unread frame
+static unsigned char rxWrite = 0;                                       // end of the frame being received (ISR, or with RXIE off)
+static unsigned char rxState = RX_HUNT;
+static unsigned char rxLength = 0;                                      // payload bytes still expected
+static unsigned char rxCrc = 0;                                         // running CRC of the frame being received
+
+static unsigned char txFull(void) {
+    return ((txHead + 1) & (UART_TX_SIZE - 1)) == txTail;
+}
+
+static unsigned char txPending(void) {
+    return txHead != txTail;
+}
+
+// Block until blocked() returns 0, sleeping if interrupts are on and polling the hardware otherwise
+static void waitWhile(unsigned char (*blocked)(void)) {
+    if (__get_SR_register() & GIE) {
+        __disable_interrupt();
+        while (blocked()) {
+            txWaiting = 1;
+            __bis_SR_register(LPM0_bits + GIE);                         // TX ISR wakes us after making progress
+            __disable_interrupt();
+        }
+        __enable_interrupt();
+    } else {
+        while (blocked()) {                                             // called during init or from another ISR
+            if (IFG2 & UCA0TXIFG) {
+                uart_txInterrupt();
+            }
+        }
+    }
+}
+
+// Store one received byte in the frame being built, returns 0 if the ring is full
+static unsigned char rxStore(unsigned char value) {
+    unsigned char next = (rxWrite + 1) & (UART_RX_SIZE - 1);
+
+    if (next == rxTail) {
+        return 0;
+    }
+    rxQueue[rxWrite] = value;
+    rxWrite = next;
+    return 1;
+}
+
+// UART Initialization
+void initUART(void) {
+    P1SEL |= BIT1 + BIT2;  // Set P1.1, P1.2 to UART mode
+    P1SEL2 |= BIT1 + BIT2;
+
+    UCA0CTL1 |= UCSWRST;  // Hold USCI in reset
+    UCA0CTL1 |= UCSSEL_2; // Use SMCLK
+    UCA0CTL1 |= UCRXEIE;  // Deliver bytes with line errors too, so their frame can be dropped
+    uart_setBaud(UART_BAUD_9600);
+
+    IE2 |= UCA0RXIE;  // Enable RX interrupt, TX is enabled while the ring has data
+}
+
+// Switch the link speed, or re-apply it for a new clock level; queued bytes are sent first so none straddle the change
+void uart_setBaud(unsigned char index) {
+    const unsigned char *dividers = baudTable[clock_level()][index];
+
+    uart_flush();
+
+    UCA0CTL1 |= UCSWRST;
+    UCA0BR0 = dividers[0];
+    UCA0BR1 = dividers[1];
+    UCA0MCTL = dividers[2];
+    UCA0CTL1 &= ~UCSWRST;                                               // Release USCI for operation
+
+    baud = index;
+    rxWrite = rxHead;                                                   // drop a frame cut off by the change
+    rxState = RX_HUNT;
+    IE2 |= UCA0RXIE;                                                    // reset cleared the interrupt enables, and kept the ISR out until now
+}
+
+unsigned char uart_getBaud(void) {
+    return baud;
+}
+
+// Queue bytes for transmission, returns once they are all in the ring
+void uart_write(const unsigned char *data, unsigned int length) {
+    while (length--) {
+        waitWhile(txFull);
+        txQueue[txHead] = *data++;
+        txHead = (txHead + 1) & (UART_TX_SIZE - 1);
+        IE2 |= UCA0TXIE;                                                // TX ISR picks it up
+    }
+}
+
+// Wrap a payload in SYNC, LEN and CRC and queue it
+void uart_sendFrame(const unsigned char *payload, unsigned char length) {
+    unsigned char frame[UART_MAX_FRAME + UART_FRAME_OVERHEAD];
+    unsigned char crc = crc8(0, length);
+    unsigned char i;
+
+    frame[0] = UART_SYNC;
+    frame[1] = length;
+    for (i = 0; i < length; i++) {
+        frame[i + 2] = payload[i];
+        crc = crc8(crc, payload[i]);
+    }
+    frame[length + 2] = crc;
+
+    uart_write(frame, length + UART_FRAME_OVERHEAD);
+}
+
+// Copy the oldest complete frame's payload out of the ring, returns its length or 0 if none is waiting
+unsigned char uart_readFrame(unsigned char *payload, unsigned char size) {
+    unsigned char length, i;
+
+    if (rxTail == rxHead) {
+        return 0;
+    }
+
+    length = rxQueue[rxTail];
+    rxTail = (rxTail + 1) & (UART_RX_SIZE - 1);
+    for (i = 0; i < length; i++) {
+        if (i < size) {
+            payload[i] = rxQueue[rxTail];
+        }
+        rxTail = (rxTail + 1) & (UART_RX_SIZE - 1);
+    }
+
+    return (length < size) ? length : size;
+}
+
+// Fence: wait until the last queued byte has left the shift register
+void uart_flush(void) {
+    waitWhile(txPending);
+    while (UCA0STAT & UCBUSY);
+}
+
+// Move one byte into UCA0TXBUF, returns 1 when a waiter should be woken
+unsigned char uart_txInterrupt(void) {
+    if (txTail != txHead) {
+        UCA0TXBUF = txQueue[txTail];
+        txTail = (txTail + 1) & (UART_TX_SIZE - 1);
+    }
+
+    if (txTail == txHead) {
+        IE2 &= ~UCA0TXIE;                                               // ring drained
+    }
+
+    if (txWaiting) {
+        txWaiting = 0;
+        return 1;
+    }
+    return 0;
+}
+
+// UART Receive Handler
+#pragma vector = USCIAB0RX_VECTOR
+__interrupt void USCI0RX_ISR(void) {
+    unsigned char status = UCA0STAT;                                    // error flags clear when RXBUF is read
+    unsigned char received = UCA0RXBUF;
+
+    TRACE_BEGIN(TRACE_ISR_USCI_RX);
+    if (status & (UCOE + UCFE + UCPE + UCBRK)) {
+        if (status & UCOE) {
+            uartStats.overruns++;
+        } else {
+            uartStats.framingErrors++;
+        }
+        rxWrite = rxHead;                                               // a byte of this frame is missing or corrupt
+        rxState = RX_HUNT;
+        TRACE_END(TRACE_ISR_USCI_RX);
+        return;
+    }
+
+    switch (rxState) {
+        case RX_HUNT:
+            if (received == UART_SYNC) {
+                rxState = RX_LENGTH;
+            }
+            break;
+        case RX_LENGTH:
+            if (received == 0 || received > UART_MAX_FRAME) {
+                uartStats.framingErrors++;
+                rxState = (received == UART_SYNC) ? RX_LENGTH : RX_HUNT;
+            } else if (!rxStore(received)) {
+                uartStats.dropped++;                                    // reader is behind, lose this frame only
+                rxWrite = rxHead;
+                rxState = RX_HUNT;
+            } else {
+                rxLength = received;
+                rxCrc = crc8(0, received);
+                rxState = RX_PAYLOAD;
+            }
+            break;
+        case RX_PAYLOAD:
+            if (!rxStore(received)) {
+                uartStats.dropped++;
+                rxWrite = rxHead;
+                rxState = RX_HUNT;
+            } else {
+                rxCrc = crc8(rxCrc, received);
+                if (--rxLength == 0) {
+                    rxState = RX_CRC;
+                }
+            }
+            break;
+        case RX_CRC:
+            rxState = RX_HUNT;
+            if (received != rxCrc) {
+                uartStats.crcErrors++;
+                rxWrite = rxHead;
+                break;
+            }
+            rxHead = rxWrite;                                           // publish the complete frame
+            uartStats.frames++;
+            pushEvent(EVENT_FRAME, 0);
+            __bic_SR_register_on_exit(LPM3_bits);                       // Wake the main loop to handle the frame
+            break;
+    }
+    TRACE_END(TRACE_ISR_USCI_RX);
+}
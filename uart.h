@@ -0,0 +1,53 @@
+/*
+ * uart.h
+ */
+
+#ifndef UART_H_
+#define UART_H_
+
+/* ====================================================================
+ * UART Queue Settings
+ * ==================================================================== */
+#define UART_TX_SIZE        16                                          // queued bytes, must be a power of two
+#define UART_RX_SIZE        32                                          // received bytes, must be a power of two
+#define UART_MAX_FRAME      8                                           // longest frame payload
+
+/* ====================================================================
+ * Frame Format: SYNC, LEN, LEN payload bytes, CRC-8 over LEN and payload
+ * ==================================================================== */
+#define UART_SYNC           0x7E
+#define UART_FRAME_OVERHEAD 3                                           // SYNC, LEN and CRC
+
+/* ====================================================================
+ * Baud Rates (index into the divider table)
+ * ==================================================================== */
+#define UART_BAUD_9600      0
+#define UART_BAUD_19200     1
+#define UART_BAUD_38400     2
+#define UART_BAUD_57600     3
+#define UART_BAUD_115200    4
+#define UART_BAUDS          5
+
+typedef struct {
+    unsigned int frames;                                                // frames received with a good CRC
+    unsigned int overruns;                                              // bytes lost in the USCI (UCOE)
+    unsigned int framingErrors;                                         // bad stop/parity bit, break, or bad length
+    unsigned int crcErrors;                                             // frames whose CRC did not match
+    unsigned int dropped;                                               // frames discarded for lack of ring space
+} UartStats;
+
+extern volatile UartStats uartStats;
+
+/* ====================================================================
+ * UART Prototype Definitions
+ * ==================================================================== */
+void initUART(void);
+void uart_setBaud(unsigned char);
+unsigned char uart_getBaud(void);
+void uart_write(const unsigned char *, unsigned int);
+void uart_sendFrame(const unsigned char *, unsigned char);
+unsigned char uart_readFrame(unsigned char *, unsigned char);
+void uart_flush(void);
+unsigned char uart_txInterrupt(void);
+
+#endif /* UART_H_ */
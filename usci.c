@@ -0,0 +1,29 @@
+/*
+ * usci.c
+ *
+ * USCI_A0 and USCI_B0 share one transmit interrupt vector on the G2553.
+ * Dispatch it to the UART and I2C drivers.
+ */
+
+#include <msp430.h>
+#include "i2c.h"
+#include "uart.h"
+#include "trace.h"
+
+#pragma vector = USCIAB0TX_VECTOR
+__interrupt void USCI0TX_ISR(void) {
+    unsigned char wake = 0;
+
+    TRACE_BEGIN(TRACE_ISR_USCI_TX);
+    if ((IFG2 & UCA0TXIFG) && (IE2 & UCA0TXIE)) {
+        wake |= uart_txInterrupt();
+    }
+    if ((IFG2 & UCB0TXIFG) && (IE2 & UCB0TXIE)) {
+        wake |= i2c_txInterrupt();
+    }
+
+    if (wake) {
+        __bic_SR_register_on_exit(LPM0_bits);                           // resume the waiting caller
+    }
+    TRACE_END(TRACE_ISR_USCI_TX);
+}